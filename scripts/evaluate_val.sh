@@ -3,7 +3,7 @@
 if [ -z "$1" ]
   then
     echo "No folder supplied!"
-    echo "Usage: bash `basename "$0"` alov_video_folder alov_annotations_folder"
+    echo "Usage: bash `basename "$0"` alov_video_folder alov_annotations_folder [deploy.prototxt network.caffemodel]"
     exit
 fi
 
@@ -21,9 +21,15 @@ ANNOTATIONS_FOLDER=$2
 
 FOLDER=GOTURN1_val
 
-DEPLOY_PROTO=nets/tracker.prototxt
+# Evaluate the pre-trained tracker, unless another network (e.g. a distilled student) is given.
+DEPLOY_PROTO=${3:-nets/tracker.prototxt}
 
-CAFFE_MODEL=nets/models/pretrained_model/tracker.caffemodel
+CAFFE_MODEL=${4:-nets/models/pretrained_model/tracker.caffemodel}
+
+if [ -n "$3" ]
+  then
+    FOLDER=${FOLDER}_$(basename $CAFFE_MODEL .caffemodel)
+fi
 
 OUTPUT_FOLDER=nets/tracker_output/$FOLDER
 
@@ -0,0 +1,45 @@
+#!/bin/bash
+
+if [ -z "$1" ]
+  then
+    echo "No folder supplied!"
+    echo "Usage: bash `basename "$0"` examples_folder"
+    echo "where examples_folder is the output folder of build/export_examples"
+    exit
+fi
+
+GPU_ID=0
+FOLDER=GOTURN1_lmdb
+RANDOM_SEED=800
+
+# Caffe's command-line tool (e.g. caffe_root/build/tools/caffe).
+CAFFE=${CAFFE:-caffe}
+
+echo FOLDER: $FOLDER
+
+EXAMPLES_FOLDER=$1
+SOLVER=nets/solver.prototxt
+TRAIN_PROTO_TEMPLATE=nets/tracker_lmdb.prototxt
+CAFFE_MODEL=nets/models/weights_init/tracker_init.caffemodel
+
+BASEDIR=nets
+RESULT_DIR=$BASEDIR/results/$FOLDER
+SOLVERSTATE_DIR=$BASEDIR/solverstate/$FOLDER
+
+#Make folders to store results and snapshots
+mkdir -p $RESULT_DIR
+mkdir -p $SOLVERSTATE_DIR
+
+#Point the Data layers at the exported examples
+mkdir -p nets/solver_temp
+TRAIN_PROTO=nets/solver_temp/tracker_lmdb_$FOLDER.prototxt
+sed s#EXAMPLES_FOLDER#$EXAMPLES_FOLDER# <$TRAIN_PROTO_TEMPLATE >$TRAIN_PROTO
+
+#Modify solver to save snapshot in SOLVERSTATE_DIR
+SOLVER_TEMP=nets/solver_temp/solver_temp_$FOLDER.prototxt
+sed s#SOLVERSTATE_DIR#$SOLVERSTATE_DIR# <$SOLVER >$SOLVER_TEMP
+sed -i s#TRAIN_FILE#$TRAIN_PROTO# $SOLVER_TEMP
+sed -i s#DEVICE_ID#$GPU_ID# $SOLVER_TEMP
+sed -i s#RANDOM_SEED#$RANDOM_SEED# $SOLVER_TEMP
+
+$CAFFE train -solver $SOLVER_TEMP -weights $CAFFE_MODEL -gpu $GPU_ID 2> $RESULT_DIR/results.txt
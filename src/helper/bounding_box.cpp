@@ -101,16 +101,18 @@ void BoundingBox::Print() const {
 }
 
 void BoundingBox::Scale(const cv::Mat& image, BoundingBox* bbox_scaled) const {
-  *bbox_scaled = *this;
+  Scale(image.cols, image.rows, bbox_scaled);
+}
 
-  const int width = image.cols;
-  const int height = image.rows;
+void BoundingBox::Scale(const double image_width, const double image_height,
+                        BoundingBox* bbox_scaled) const {
+  *bbox_scaled = *this;
 
   // Scale the bounding box so that the coordinates range from 0 to 1.
-  bbox_scaled->x1_ /= width;
-  bbox_scaled->y1_ /= height;
-  bbox_scaled->x2_ /= width;
-  bbox_scaled->y2_ /= height;
+  bbox_scaled->x1_ /= image_width;
+  bbox_scaled->y1_ /= image_height;
+  bbox_scaled->x2_ /= image_width;
+  bbox_scaled->y2_ /= image_height;
 
   // Scale the bounding box so that the coordinates range from 0 to scale_factor_.
   bbox_scaled->x1_ *= scale_factor_;
@@ -120,10 +122,12 @@ void BoundingBox::Scale(const cv::Mat& image, BoundingBox* bbox_scaled) const {
 }
 
 void BoundingBox::Unscale(const cv::Mat& image, BoundingBox* bbox_unscaled) const {
-  *bbox_unscaled = *this;
+  Unscale(image.cols, image.rows, bbox_unscaled);
+}
 
-  const int image_width = image.cols;
-  const int image_height = image.rows;
+void BoundingBox::Unscale(const double image_width, const double image_height,
+                          BoundingBox* bbox_unscaled) const {
+  *bbox_unscaled = *this;
 
   // Unscale the bounding box so that the coordinates range from 0 to 1.
   bbox_unscaled->x1_ /= scale_factor_;
@@ -242,6 +246,7 @@ void BoundingBox::Shift(const cv::Mat& image,
                         const double lambda_shift_frac,
                         const double min_scale, const double max_scale,
                         const bool shift_motion_model,
+                        Rng* rng,
                         BoundingBox* bbox_rand) const {
   const double width = get_width();
   const double height = get_height();
@@ -259,9 +264,9 @@ void BoundingBox::Shift(const cv::Mat& image,
     // Sample.
     double width_scale_factor;
     if (shift_motion_model) {
-      width_scale_factor = max(min_scale, min(max_scale, sample_exp_two_sided(lambda_scale_frac)));
+      width_scale_factor = max(min_scale, min(max_scale, sample_exp_two_sided(lambda_scale_frac, rng)));
     } else {
-      const double rand_num = sample_rand_uniform();
+      const double rand_num = sample_rand_uniform(rng);
       width_scale_factor = rand_num * (max_scale - min_scale) + min_scale;
     }
     // Expand width by scaling factor.
@@ -278,9 +283,9 @@ void BoundingBox::Shift(const cv::Mat& image,
     // Sample.
     double height_scale_factor;
     if (shift_motion_model) {
-      height_scale_factor = max(min_scale, min(max_scale, sample_exp_two_sided(lambda_scale_frac)));
+      height_scale_factor = max(min_scale, min(max_scale, sample_exp_two_sided(lambda_scale_frac, rng)));
     } else {
-      const double rand_num = sample_rand_uniform();
+      const double rand_num = sample_rand_uniform(rng);
       height_scale_factor = rand_num * (max_scale - min_scale) + min_scale;
     }
     // Expand height by scaling factor.
@@ -305,9 +310,9 @@ void BoundingBox::Shift(const cv::Mat& image,
     // Sample.
     double new_x_temp;
     if (shift_motion_model) {
-      new_x_temp = center_x + width * sample_exp_two_sided(lambda_shift_frac);
+      new_x_temp = center_x + width * sample_exp_two_sided(lambda_shift_frac, rng);
     } else {
-      const double rand_num = sample_rand_uniform();
+      const double rand_num = sample_rand_uniform(rng);
       new_x_temp = center_x + rand_num * (2 * new_width) - new_width;
     }
     // Make sure that the window stays within the image.
@@ -331,9 +336,9 @@ void BoundingBox::Shift(const cv::Mat& image,
     // Sample.
     double new_y_temp;
     if (shift_motion_model) {
-      new_y_temp = center_y + height * sample_exp_two_sided(lambda_shift_frac);
+      new_y_temp = center_y + height * sample_exp_two_sided(lambda_shift_frac, rng);
     } else {
-      const double rand_num = sample_rand_uniform();
+      const double rand_num = sample_rand_uniform(rng);
       new_y_temp = center_y + rand_num * (2 * new_height) - new_height;
     }
     // Make sure that the window stays within the image.
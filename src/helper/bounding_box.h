@@ -8,6 +8,8 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include "helper/rng.h"
+
 class VOTRegion;
 
 // Represents a bounding box on an image, with some additional functionality.
@@ -41,6 +43,11 @@ public:
   // (Undoes the effect of Scale).
   void Unscale(const cv::Mat& image, BoundingBox* bbox_unscaled) const;
 
+  // Same as above, for an image of the given size (e.g. the full-resolution
+  // size of a crop that was taken from a coarser pyramid level).
+  void Scale(const double image_width, const double image_height, BoundingBox* bbox_scaled) const;
+  void Unscale(const double image_width, const double image_height, BoundingBox* bbox_unscaled) const;
+
   // Compute location of bounding box relative to search region
   // edge_spacing_x and edge_spacing_y is the spaving of the image within the search region to account for edge effects.
   // *this should be the ground-truth bbox.
@@ -53,11 +60,13 @@ public:
                 const double edge_spacing_x, const double edge_spacing_y,
                 BoundingBox* bbox_uncentered) const;
 
-  // Shift the cropped region of the image to generate a new random training example.
+  // Shift the cropped region of the image to generate a new random training example,
+  // drawing the random shift from rng.
   void Shift(const cv::Mat& image,
              const double lambda_scale_frac, const double lambda_shift_frac,
              const double min_scale, const double max_scale,
              const bool shift_motion_model,
+             Rng* rng,
              BoundingBox* bbox_rand) const;
 
   double get_scale_factor() const { return scale_factor_; }
@@ -11,6 +11,10 @@
 #include <cstdio>
 #include <vector>
 
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
 namespace bfs = boost::filesystem;
 
 using std::string;
@@ -138,3 +142,30 @@ double sample_exp_two_sided(const double lambda) {
   const double rand_uniform = sample_rand_uniform();
   return log(rand_uniform) / lambda * pos_or_neg;
 }
+
+double sample_rand_uniform(Rng* rng) {
+  return rng->Uniform();
+}
+
+double sample_exp(const double lambda, Rng* rng) {
+  const double rand_uniform = sample_rand_uniform(rng);
+  return -log(rand_uniform) / lambda;
+}
+
+double sample_exp_two_sided(const double lambda, Rng* rng) {
+  // Determine which side of the two-sided exponential we are sampling from.
+  const double pos_or_neg = (rng->Next() >> 63) == 0 ? 1 : -1;
+
+  const double rand_uniform = sample_rand_uniform(rng);
+  return log(rand_uniform) / lambda * pos_or_neg;
+}
+
+bool set_thread_affinity(const int first_core, const int num_cores) {
+  const int total_cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int i = 0; i < num_cores; ++i) {
+    CPU_SET((first_core + i) % total_cores, &cpu_set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
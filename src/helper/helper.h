@@ -19,6 +19,8 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include "helper/rng.h"
+
 // Convenience helper functions.
 
 // *******Number / string conversions*************
@@ -65,5 +67,16 @@ double sample_exp(const double lambda);
 // Sample from a Laplacian distribution, aka two-sided exponential.
 double sample_exp_two_sided(const double lambda);
 
+// As above, but drawing from the given generator instead of rand(), so that
+// threads can sample independently and reproducibly.
+double sample_rand_uniform(Rng* rng);
+double sample_exp(const double lambda, Rng* rng);
+double sample_exp_two_sided(const double lambda, Rng* rng);
+
+// *******Threads*************
+// Restrict the calling thread to run on cores [first_core, first_core + num_cores)
+// (wrapping around the number of cores).  Returns false if this fails.
+bool set_thread_affinity(const int first_core, const int num_cores);
+
 #endif /* HELPER_H_ */
 
@@ -0,0 +1,56 @@
+#include "image_decode.h"
+
+#include <algorithm>
+
+#include <opencv2/highgui/highgui.hpp>
+
+// Largest supported reduction.
+const int kMaxDecodeReduction = 8;
+
+namespace {
+
+// Get the imread / imdecode flags to decode a color image at the given
+// reduction, and the reduction that these flags apply.
+int ReducedColorFlags(const int reduction, int* actual_reduction) {
+#if CV_MAJOR_VERSION >= 3
+  *actual_reduction = reduction;
+  if (reduction == 2) {
+    return cv::IMREAD_REDUCED_COLOR_2;
+  } else if (reduction == 4) {
+    return cv::IMREAD_REDUCED_COLOR_4;
+  } else if (reduction == 8) {
+    return cv::IMREAD_REDUCED_COLOR_8;
+  }
+#endif
+  // Reduced decoding requires OpenCV 3.
+  *actual_reduction = 1;
+  return cv::IMREAD_COLOR;
+}
+
+} // namespace
+
+int ComputeDecodeReduction(const BoundingBox& bbox, const double min_crop_size) {
+  // Size of the padded region that will be cropped around the box.
+  const double crop_size = std::min(bbox.compute_output_width(),
+                                    bbox.compute_output_height());
+
+  int reduction = 1;
+  while (reduction < kMaxDecodeReduction && crop_size / (2 * reduction) >= min_crop_size) {
+    reduction *= 2;
+  }
+  return reduction;
+}
+
+int ReadImageReduced(const std::string& image_file, const int reduction, cv::Mat* image) {
+  int actual_reduction;
+  const int flags = ReducedColorFlags(reduction, &actual_reduction);
+  *image = cv::imread(image_file, flags);
+  return actual_reduction;
+}
+
+int DecodeImageReduced(const cv::Mat& buffer, const int reduction, cv::Mat* image) {
+  int actual_reduction;
+  const int flags = ReducedColorFlags(reduction, &actual_reduction);
+  *image = cv::imdecode(buffer, flags);
+  return actual_reduction;
+}
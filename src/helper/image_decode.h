@@ -0,0 +1,30 @@
+#ifndef IMAGE_DECODE_H
+#define IMAGE_DECODE_H
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "bounding_box.h"
+
+// Functions to decode images at reduced resolution.  JPEG files can be decoded
+// directly at 1/2, 1/4, or 1/8 of their size (using libjpeg's DCT scaling),
+// which is several times faster than decoding the full image, so when only a
+// crop around an object is needed at network resolution, it is wasteful to
+// decode the image at full size.
+
+// Choose the largest reduction (1, 2, 4, or 8) for which the padded crop
+// around bbox (in full-resolution image coordinates) still has at least
+// min_crop_size pixels in each dimension.
+int ComputeDecodeReduction(const BoundingBox& bbox, const double min_crop_size);
+
+// Read the image, reduced in size by the given factor (1, 2, 4, or 8).
+// Returns the reduction that was applied: if reduced decoding is not
+// available, the image is read at full size and 1 is returned.
+int ReadImageReduced(const std::string& image_file, const int reduction, cv::Mat* image);
+
+// As ReadImageReduced, but decode an image that is already in memory (the
+// encoded bytes, as a single row of CV_8U).
+int DecodeImageReduced(const cv::Mat& buffer, const int reduction, cv::Mat* image);
+
+#endif // IMAGE_DECODE_H
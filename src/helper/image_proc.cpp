@@ -1,5 +1,9 @@
 #include "image_proc.h"
 
+// Size of the network input.  Pyramid crops are taken from the coarsest level
+// whose crop is still at least this large, so no resolution is lost.
+const double kPyramidMinCropSize = 227;
+
 void ComputeCropPadImageLocation(const BoundingBox& bbox_tight, const cv::Mat& image, BoundingBox* pad_image_location) {
   // Get the bounding box center.
   const double bbox_center_x = bbox_tight.get_center_x();
@@ -104,3 +108,117 @@ void CropPadImage(const BoundingBox& bbox_tight, const cv::Mat& image, cv::Mat*
   *pad_image = output_image;
 }
 
+
+void CropPadImage(const BoundingBox& bbox_tight, const ImagePyramid& pyramid, cv::Mat* pad_image) {
+  BoundingBox pad_image_location;
+  double edge_spacing_x, edge_spacing_y, pad_image_scale;
+  CropPadImage(bbox_tight, pyramid, pad_image, &pad_image_location, &edge_spacing_x, &edge_spacing_y,
+               &pad_image_scale);
+}
+
+void CropPadImage(const BoundingBox& bbox_tight, const ImagePyramid& pyramid, cv::Mat* pad_image,
+                  BoundingBox* pad_image_location, double* edge_spacing_x, double* edge_spacing_y,
+                  double* pad_image_scale) {
+  // Choose the coarsest pyramid level at which the padded crop is still at least
+  // as large as the network input.
+  const int level = pyramid.ChooseLevel(bbox_tight.compute_output_width(),
+                                        bbox_tight.compute_output_height(),
+                                        kPyramidMinCropSize);
+  const double scale = ImagePyramid::get_level_scale(level);
+  *pad_image_scale = scale;
+
+  if (level == 0) {
+    // The crop is small enough to take directly from the full-resolution image.
+    CropPadImage(bbox_tight, pyramid.get_image(), pad_image, pad_image_location,
+                 edge_spacing_x, edge_spacing_y);
+    return;
+  }
+
+  // Express the bounding box in the coordinates of the chosen level.
+  BoundingBox bbox_level = bbox_tight;
+  bbox_level.x1_ /= scale;
+  bbox_level.y1_ /= scale;
+  bbox_level.x2_ /= scale;
+  bbox_level.y2_ /= scale;
+
+  // Crop from the chosen level.
+  const cv::Mat& image = pyramid.GetLevel(level);
+  BoundingBox level_location;
+  double level_edge_spacing_x, level_edge_spacing_y;
+  CropPadImage(bbox_level, image, pad_image, &level_location,
+               &level_edge_spacing_x, &level_edge_spacing_y);
+
+  // The crop was copied to integer coordinates of the level (truncating the
+  // crop location and the edge spacing), and a pixel of a coarse level spans
+  // several full-resolution pixels, so convert the placement that was used,
+  // rather than the fractional values, back into full-resolution coordinates.
+  // Recenter and Uncenter then map boxes exactly onto the crop's pixels.
+  const double roi_left = static_cast<int>(std::min(level_location.x1_, static_cast<double>(image.cols - 1)));
+  const double roi_bottom = static_cast<int>(std::min(level_location.y1_, static_cast<double>(image.rows - 1)));
+  pad_image_location->x1_ = roi_left * scale;
+  pad_image_location->y1_ = roi_bottom * scale;
+  pad_image_location->x2_ = level_location.x2_ * scale;
+  pad_image_location->y2_ = level_location.y2_ * scale;
+  *edge_spacing_x = static_cast<int>(level_edge_spacing_x) * scale;
+  *edge_spacing_y = static_cast<int>(level_edge_spacing_y) * scale;
+}
+
+void WarpCropPadImage(const BoundingBox& bbox_tight, const ImagePyramid& pyramid,
+                      const cv::Size& output_size, cv::Mat* pad_image,
+                      BoundingBox* pad_image_location, double* edge_spacing_x,
+                      double* edge_spacing_y, cv::Size2d* pad_image_size) {
+  // Choose the pyramid level exactly as CropPadImage does.
+  const int level = pyramid.ChooseLevel(bbox_tight.compute_output_width(),
+                                        bbox_tight.compute_output_height(),
+                                        kPyramidMinCropSize);
+  const double scale = ImagePyramid::get_level_scale(level);
+  const cv::Mat& image = pyramid.GetLevel(level);
+
+  // Express the bounding box in the coordinates of the chosen level.
+  BoundingBox bbox_level = bbox_tight;
+  bbox_level.x1_ /= scale;
+  bbox_level.y1_ /= scale;
+  bbox_level.x2_ /= scale;
+  bbox_level.y2_ /= scale;
+
+  // Compute the ROI and the size of the padded crop, as in CropPadImage.
+  BoundingBox level_location;
+  ComputeCropPadImageLocation(bbox_level, image, &level_location);
+  const double roi_left = std::min(level_location.x1_, static_cast<double>(image.cols - 1));
+  const double roi_bottom = std::min(level_location.y1_, static_cast<double>(image.rows - 1));
+  const double roi_width = std::min(static_cast<double>(image.cols), std::max(1.0, ceil(level_location.x2_ - level_location.x1_)));
+  const double roi_height = std::min(static_cast<double>(image.rows), std::max(1.0, ceil(level_location.y2_ - level_location.y1_)));
+  const double pad_width = std::max(ceil(bbox_level.compute_output_width()), roi_width);
+  const double pad_height = std::max(ceil(bbox_level.compute_output_height()), roi_height);
+  const double level_edge_spacing_x = std::min(bbox_level.edge_spacing_x(), pad_width - 1);
+  const double level_edge_spacing_y = std::min(bbox_level.edge_spacing_y(), pad_height - 1);
+
+  // Pixel (x, y) of the padded crop is pixel (x + origin_x, y + origin_y) of
+  // the level.  The warp samples the level at fractional coordinates, so the
+  // origin keeps the fractional crop location and edge spacing (unlike the
+  // integer placement of CropPadImage), which Recenter and Uncenter use.
+  const double origin_x = roi_left - level_edge_spacing_x;
+  const double origin_y = roi_bottom - level_edge_spacing_y;
+
+  // Map each output pixel to the level as cv::resize would map it to the padded
+  // crop (aligning pixel centers).  Pixels that fall outside of the level are
+  // black, which gives the padding of CropPadImage.
+  const double scale_x = pad_width / output_size.width;
+  const double scale_y = pad_height / output_size.height;
+  const cv::Matx23d output_to_level(scale_x, 0, origin_x + 0.5 * scale_x - 0.5,
+                                    0, scale_y, origin_y + 0.5 * scale_y - 0.5);
+  pad_image->create(output_size, image.type());
+  cv::warpAffine(image, *pad_image, output_to_level, output_size,
+                 cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_CONSTANT,
+                 cv::Scalar(0, 0, 0));
+
+  // Convert the crop location, edge spacing, and crop size back into
+  // full-resolution coordinates, as CropPadImage does.
+  pad_image_location->x1_ = level_location.x1_ * scale;
+  pad_image_location->y1_ = level_location.y1_ * scale;
+  pad_image_location->x2_ = level_location.x2_ * scale;
+  pad_image_location->y2_ = level_location.y2_ * scale;
+  *edge_spacing_x = level_edge_spacing_x * scale;
+  *edge_spacing_y = level_edge_spacing_y * scale;
+  *pad_image_size = cv::Size2d(pad_width * scale, pad_height * scale);
+}
@@ -2,6 +2,7 @@
 #define IMAGE_PROC_H
 
 #include "bounding_box.h"
+#include "image_pyramid.h"
 
 // Functions to process images for tracking.
 
@@ -12,6 +13,31 @@ void CropPadImage(const BoundingBox& bbox_tight, const cv::Mat& image, cv::Mat*
 void CropPadImage(const BoundingBox& bbox_tight, const cv::Mat& image, cv::Mat* pad_image,
                   BoundingBox* pad_image_location, double* edge_spacing_x, double* edge_spacing_y);
 
+// Crop the image at the bounding box location as above, but take the crop from the
+// coarsest pyramid level that is still at least as large as the network input, so
+// that large boxes do not copy full-resolution pixels only to be downsampled later.
+// pad_image_location, edge_spacing_x, and edge_spacing_y are returned in
+// full-resolution image coordinates (with the same meaning as above, for the
+// whole level pixels at which the crop was placed), and pad_image_scale is the
+// factor that converts pad_image pixels into full-resolution pixels.
+void CropPadImage(const BoundingBox& bbox_tight, const ImagePyramid& pyramid, cv::Mat* pad_image);
+void CropPadImage(const BoundingBox& bbox_tight, const ImagePyramid& pyramid, cv::Mat* pad_image,
+                  BoundingBox* pad_image_location, double* edge_spacing_x, double* edge_spacing_y,
+                  double* pad_image_scale);
+
+// Make the same crop as the pyramid version of CropPadImage, already resized to
+// output_size, with a single affine warp of the chosen pyramid level (instead of
+// copying the crop into a padded image and then resizing it).  The crop is
+// placed at fractional coordinates of the level, rather than rounded to whole
+// level pixels.  pad_image is
+// reused if it already has the right size and type.  pad_image_location,
+// edge_spacing_x, and edge_spacing_y are as above, and pad_image_size is the
+// full-resolution size of the padded crop before it was resized.
+void WarpCropPadImage(const BoundingBox& bbox_tight, const ImagePyramid& pyramid,
+                      const cv::Size& output_size, cv::Mat* pad_image,
+                      BoundingBox* pad_image_location, double* edge_spacing_x,
+                      double* edge_spacing_y, cv::Size2d* pad_image_size);
+
 // Compute the location of the cropped image, which is centered on the bounding box center
 // but has a size given by (output_width, output_height) to account for additional padding.
 // The cropped image location is also limited by the edge of the image.
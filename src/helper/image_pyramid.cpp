@@ -0,0 +1,59 @@
+#include "image_pyramid.h"
+
+#include <algorithm>
+
+// Maximum number of levels below the full-resolution image.
+// A 1920-pixel crop reaches the network input size after 3 levels.
+const int kMaxPyramidLevel = 4;
+
+ImagePyramid::ImagePyramid()
+  : levels_(1)
+{
+}
+
+ImagePyramid::ImagePyramid(const cv::Mat& image)
+  : levels_(1, image)
+{
+  // Reserve space for all levels so that references returned by GetLevel
+  // stay valid when coarser levels are added later.
+  levels_.reserve(kMaxPyramidLevel + 1);
+}
+
+const cv::Mat& ImagePyramid::GetLevel(const int level) const {
+  const int max_level = std::min(level, kMaxPyramidLevel);
+
+  // Compute any missing levels, each from the previous (finer) level.
+  while (static_cast<int>(levels_.size()) <= max_level) {
+    cv::Mat next_level;
+    cv::pyrDown(levels_.back(), next_level);
+    levels_.push_back(next_level);
+  }
+
+  return levels_[max_level];
+}
+
+int ImagePyramid::ChooseLevel(const double width, const double height,
+                              const double min_size) const {
+  const cv::Mat& image = levels_[0];
+  if (image.empty()) {
+    return 0;
+  }
+
+  int level = 0;
+  while (level < kMaxPyramidLevel) {
+    // Size of the region and of the image at the next coarser level.
+    const double next_scale = get_level_scale(level + 1);
+    const double next_width = width / next_scale;
+    const double next_height = height / next_scale;
+
+    // Stop if the region would become smaller than the requested size, or if
+    // the image itself would become degenerate.
+    if (next_width < min_size || next_height < min_size ||
+        image.cols / next_scale < 2 || image.rows / next_scale < 2) {
+      break;
+    }
+    level++;
+  }
+
+  return level;
+}
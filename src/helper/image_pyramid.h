@@ -0,0 +1,40 @@
+#ifndef IMAGE_PYRAMID_H
+#define IMAGE_PYRAMID_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+// A Gaussian image pyramid.  Level 0 is the original image, and each level is
+// half the width and height of the previous level.  Coarser levels are only
+// computed the first time that they are requested, so an unused pyramid costs
+// no more than the original image.
+// Not thread-safe: each thread should use its own pyramid.
+class ImagePyramid
+{
+public:
+  ImagePyramid();
+  explicit ImagePyramid(const cv::Mat& image);
+
+  // Get the image at the given pyramid level, computing it if needed.
+  const cv::Mat& GetLevel(const int level) const;
+
+  // Choose the coarsest level at which a region with the given full-resolution
+  // size still has at least min_size pixels in each dimension.
+  int ChooseLevel(const double width, const double height,
+                  const double min_size) const;
+
+  // Factor by which to multiply coordinates in the given level to get
+  // coordinates in the full-resolution image.
+  static double get_level_scale(const int level) { return 1 << level; }
+
+  // Get the full-resolution image.
+  const cv::Mat& get_image() const { return levels_[0]; }
+
+private:
+  // Computed pyramid levels; levels_[0] is the full-resolution image.
+  mutable std::vector<cv::Mat> levels_;
+};
+
+#endif // IMAGE_PYRAMID_H
@@ -0,0 +1,54 @@
+#include "rng.h"
+
+namespace {
+
+uint64_t Rotl(const uint64_t x, const int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+uint64_t SplitMix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+} // namespace
+
+Rng::Rng(const uint64_t seed, const uint64_t stream) {
+  Seed(seed, stream);
+}
+
+void Rng::Seed(const uint64_t seed, const uint64_t stream) {
+  // Mix the seed and the stream, then expand them into the state.
+  uint64_t x = seed;
+  x = SplitMix64(&x) ^ (stream * 0xd1b54a32d192ed03ULL);
+  for (int i = 0; i < 4; ++i) {
+    state_[i] = SplitMix64(&x);
+  }
+}
+
+uint64_t Rng::Next() {
+  const uint64_t result = Rotl(state_[1] * 5, 7) * 9;
+  const uint64_t t = state_[1] << 17;
+
+  state_[2] ^= state_[0];
+  state_[3] ^= state_[1];
+  state_[1] ^= state_[2];
+  state_[0] ^= state_[3];
+
+  state_[2] ^= t;
+  state_[3] = Rotl(state_[3], 45);
+
+  return result;
+}
+
+double Rng::Uniform() {
+  // Use the top 53 bits, offset by half a step so that 0 is never returned.
+  return ((Next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+int Rng::UniformInt(const int n) {
+  // Scale 32 random bits to [0, n) (the bias is negligible for our n).
+  return static_cast<int>(((Next() >> 32) * static_cast<uint64_t>(n)) >> 32);
+}
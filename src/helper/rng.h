@@ -0,0 +1,32 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// A small, fast pseudo-random number generator (xoshiro256**, seeded with
+// splitmix64).  Unlike rand(), each Rng has its own state, so threads that each
+// use their own Rng do not contend on a lock or perturb each other's sequences,
+// and a given seed and stream always produce the same sequence.
+class Rng
+{
+public:
+  // Seed the generator; different streams of the same seed give independent
+  // sequences (e.g. one per thread).
+  explicit Rng(const uint64_t seed = 0, const uint64_t stream = 0);
+
+  void Seed(const uint64_t seed, const uint64_t stream);
+
+  // Next 64 random bits.
+  uint64_t Next();
+
+  // Uniform random number in (0, 1).
+  double Uniform();
+
+  // Uniform random integer in [0, n).
+  int UniformInt(const int n);
+
+private:
+  uint64_t state_[4];
+};
+
+#endif // RNG_H
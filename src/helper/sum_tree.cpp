@@ -0,0 +1,47 @@
+#include "sum_tree.h"
+
+SumTree::SumTree(const int num_leaves, const double initial_weight)
+  : num_leaves_(num_leaves),
+    first_leaf_(1)
+{
+  while (first_leaf_ < num_leaves_) {
+    first_leaf_ *= 2;
+  }
+  nodes_.resize(2 * first_leaf_, 0);
+
+  // Set the leaves, then compute the sums bottom-up.
+  for (int i = 0; i < num_leaves_; ++i) {
+    nodes_[first_leaf_ + i] = initial_weight;
+  }
+  for (int node = first_leaf_ - 1; node >= 1; --node) {
+    nodes_[node] = nodes_[2 * node] + nodes_[2 * node + 1];
+  }
+}
+
+void SumTree::Set(const int leaf, const double weight) {
+  int node = first_leaf_ + leaf;
+  nodes_[node] = weight;
+
+  // Recompute the sums (rather than adding the difference), so that rounding
+  // errors do not accumulate over many updates.
+  for (node /= 2; node >= 1; node /= 2) {
+    nodes_[node] = nodes_[2 * node] + nodes_[2 * node + 1];
+  }
+}
+
+int SumTree::Find(double position) const {
+  int node = 1;
+  while (node < first_leaf_) {
+    const int left = 2 * node;
+    if (position < nodes_[left] || nodes_[left + 1] <= 0) {
+      node = left;
+    } else {
+      position -= nodes_[left];
+      node = left + 1;
+    }
+  }
+
+  // Rounding errors could otherwise lead past the last leaf.
+  const int leaf = node - first_leaf_;
+  return leaf < num_leaves_ ? leaf : num_leaves_ - 1;
+}
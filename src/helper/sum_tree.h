@@ -0,0 +1,40 @@
+#ifndef SUM_TREE_H
+#define SUM_TREE_H
+
+#include <vector>
+
+// A fixed number of non-negative weights, stored in a binary tree in which
+// each node holds the sum of its children, so that both changing a weight and
+// sampling an index in proportion to its weight take O(log n) time.
+class SumTree
+{
+public:
+  // All num_leaves weights start at initial_weight.
+  SumTree(const int num_leaves, const double initial_weight);
+
+  // Set the weight of a leaf.
+  void Set(const int leaf, const double weight);
+
+  double Get(const int leaf) const { return nodes_[first_leaf_ + leaf]; }
+
+  // Sum of all weights.
+  double get_total() const { return nodes_[1]; }
+
+  // Find the leaf at the given position in [0, get_total()), where each leaf
+  // covers a range as long as its weight; with a uniformly random position,
+  // each leaf is found with probability proportional to its weight.
+  int Find(double position) const;
+
+  int get_num_leaves() const { return num_leaves_; }
+
+private:
+  int num_leaves_;
+
+  // Index of the first leaf in nodes_ (a power of 2).  Node 1 is the root, and
+  // the children of node i are nodes 2i and 2i + 1.
+  int first_leaf_;
+
+  std::vector<double> nodes_;
+};
+
+#endif // SUM_TREE_H
@@ -19,6 +19,11 @@ const bool kDoTest = false;
 // to train the final model on the training set + validation set (not the test set!)
 const double val_ratio = 0.2;
 
+// Number of folder levels in the annotations folder (category/video.ann) and
+// in the video folder (category/video/frame.jpg).
+const int kAnnotationsFolderDepth = 1;
+const int kVideoFolderDepth = 2;
+
 LoaderAlov::LoaderAlov(const string& video_folder, const string& annotations_folder)
 {
   if (!bfs::is_directory(annotations_folder)) {
@@ -26,6 +31,26 @@ LoaderAlov::LoaderAlov(const string& video_folder, const string& annotations_fol
     return;
   }
 
+  // Load the videos from the manifest, if it is newer than both folders.
+  // Without the video folder, the manifest cannot be checked against it, so
+  // the annotations are parsed (and the manifest is not saved).
+  const string& manifest_file = ManifestFile(annotations_folder);
+  const string& sources = "alov " + video_folder + " " + annotations_folder;
+  const bool video_folder_exists = bfs::is_directory(video_folder);
+  if (!video_folder_exists) {
+    printf("Warning - %s is not a valid directory; not using a manifest\n",
+           video_folder.c_str());
+  }
+  const bool use_manifest = !kDoTest && video_folder_exists;
+  if (use_manifest) {
+    const time_t newest_source_time =
+        std::max(GetNewestFolderTime(annotations_folder, kAnnotationsFolderDepth),
+                 GetNewestFolderTime(video_folder, kVideoFolderDepth));
+    if (LoadManifest(manifest_file, sources, newest_source_time, &categories_)) {
+      return;
+    }
+  }
+
   // Find all video subcategories.
   vector<string> categories;
   find_subfolders(annotations_folder, &categories);
@@ -103,6 +128,179 @@ LoaderAlov::LoaderAlov(const string& video_folder, const string& annotations_fol
     // Save the video category.
     categories_.push_back(category);
   } // Process all categories
+
+  // Save the videos, so that they need not be parsed the next time.
+  if (use_manifest) {
+    SaveManifest(manifest_file, sources, categories_);
+  }
+}
+
+LoaderAlov::LoaderAlov(const string& shard_prefix)
+{
+  const string& index_file = ShardIndexFile(shard_prefix);
+  FILE* index_file_ptr = fopen(index_file.c_str(), "r");
+  if (!index_file_ptr) {
+    printf("Error - could not open shard index %s\n", index_file.c_str());
+    return;
+  }
+
+  size_t num_categories;
+  if (fscanf(index_file_ptr, "alov %zu\n", &num_categories) != 1) {
+    printf("Error - %s is not an ALOV shard index\n", index_file.c_str());
+    fclose(index_file_ptr);
+    return;
+  }
+
+  // Map the shards; all videos share them.
+  boost::shared_ptr<ShardReader> shard_reader(new ShardReader);
+  if (!shard_reader->Open(shard_prefix)) {
+    fclose(index_file_ptr);
+    return;
+  }
+
+  printf("Loading videos from shards %s\n", shard_prefix.c_str());
+
+  // If the index is truncated, the videos read so far are kept.
+  char name[1024];
+  bool truncated = false;
+  for (size_t i = 0; i < num_categories && !truncated; ++i) {
+    Category category;
+
+    size_t num_videos = 0;
+    if (fscanf(index_file_ptr, "%zu\n", &num_videos) != 1) {
+      truncated = true;
+      break;
+    }
+    for (size_t j = 0; j < num_videos; ++j) {
+      Video video;
+      video.shard_reader = shard_reader;
+
+      // Read the video path and the location of each frame.
+      size_t num_frames = 0;
+      size_t num_annotations = 0;
+      if (fscanf(index_file_ptr, "%1023s %zu %zu\n", name, &num_frames, &num_annotations) != 3) {
+        truncated = true;
+        break;
+      }
+      video.path = name;
+      video.all_frames.resize(num_frames);
+      video.frame_records.resize(num_frames);
+      for (size_t k = 0; k < num_frames; ++k) {
+        if (fscanf(index_file_ptr, "%1023s ", name) != 1 ||
+            !ReadShardRecord(index_file_ptr, &video.frame_records[k])) {
+          truncated = true;
+          break;
+        }
+        video.all_frames[k] = name;
+      }
+
+      // Read the annotations.
+      video.annotations.resize(num_annotations);
+      for (size_t k = 0; k < num_annotations && !truncated; ++k) {
+        Frame& frame = video.annotations[k];
+        if (fscanf(index_file_ptr, "%d %lf %lf %lf %lf\n", &frame.frame_num,
+                   &frame.bbox.x1_, &frame.bbox.y1_, &frame.bbox.x2_, &frame.bbox.y2_) != 5) {
+          truncated = true;
+          break;
+        }
+      }
+      if (truncated) {
+        break;
+      }
+
+      // Save the video.
+      videos_.push_back(video);
+      category.videos.push_back(video);
+    }
+
+    // Save the video category.
+    if (!category.videos.empty() || !truncated) {
+      categories_.push_back(category);
+    }
+  }
+  if (truncated) {
+    printf("Error - truncated shard index %s\n", index_file.c_str());
+  }
+  fclose(index_file_ptr);
+}
+
+bool LoaderAlov::SaveShards(const string& shard_prefix, const int max_image_size) const {
+  const string& index_file = ShardIndexFile(shard_prefix);
+  FILE* index_file_ptr = fopen(index_file.c_str(), "w");
+  if (!index_file_ptr) {
+    printf("Error - could not open shard index %s\n", index_file.c_str());
+    return false;
+  }
+
+  ShardWriter shard_writer(shard_prefix, max_image_size);
+
+  // The videos are written by category, so that the same videos are chosen
+  // for the training and validation sets when loading from the shards.
+  fprintf(index_file_ptr, "alov %zu\n", categories_.size());
+  size_t num_frames_packed = 0;
+  for (size_t i = 0; i < categories_.size(); ++i) {
+    const std::vector<Video>& videos = categories_[i].videos;
+    fprintf(index_file_ptr, "%zu\n", videos.size());
+    for (size_t j = 0; j < videos.size(); ++j) {
+      const Video& video = videos[j];
+      if (video.shard_reader) {
+        printf("Error - cannot repack videos that were loaded from shards\n");
+        fclose(index_file_ptr);
+        return false;
+      }
+
+      // Pack all frames.  A frame that cannot be read gets an empty record
+      // (and an error when it is loaded), as it would have without shards.
+      std::vector<ShardRecord> records(video.all_frames.size());
+      std::vector<double> scales(video.all_frames.size(), 1);
+      for (size_t k = 0; k < video.all_frames.size(); ++k) {
+        const string& image_file = video.path + "/" + video.all_frames[k];
+        if (!shard_writer.AddImage(image_file, &records[k], &scales[k])) {
+          // The index would point at missing bytes.
+          if (shard_writer.get_write_failed()) {
+            printf("Error - could not write shards %s\n", shard_prefix.c_str());
+            fclose(index_file_ptr);
+            remove(index_file.c_str());
+            return false;
+          }
+          records[k].shard = 0;
+          records[k].offset = 0;
+          records[k].size = 0;
+        }
+      }
+      num_frames_packed += records.size();
+
+      fprintf(index_file_ptr, "%s %zu %zu\n", video.path.c_str(),
+              video.all_frames.size(), video.annotations.size());
+      for (size_t k = 0; k < records.size(); ++k) {
+        fprintf(index_file_ptr, "%s ", video.all_frames[k].c_str());
+        WriteShardRecord(records[k], index_file_ptr);
+      }
+
+      // The annotations are scaled with their frames.
+      for (size_t k = 0; k < video.annotations.size(); ++k) {
+        const Frame& frame = video.annotations[k];
+        const double scale = frame.frame_num >= 0 && frame.frame_num < scales.size() ?
+            scales[frame.frame_num] : 1;
+        fprintf(index_file_ptr, "%d %lf %lf %lf %lf\n", frame.frame_num,
+                frame.bbox.x1_ * scale, frame.bbox.y1_ * scale,
+                frame.bbox.x2_ * scale, frame.bbox.y2_ * scale);
+      }
+    }
+    printf("Packed category %zu of %zu\n", i + 1, categories_.size());
+  }
+  shard_writer.Close();
+  if (shard_writer.get_write_failed()) {
+    printf("Error - could not write shards %s\n", shard_prefix.c_str());
+    fclose(index_file_ptr);
+    remove(index_file.c_str());
+    return false;
+  }
+  fclose(index_file_ptr);
+
+  printf("Packed %zu frames into %.1lf MB of shards\n", num_frames_packed,
+         shard_writer.get_bytes_written() / (1024.0 * 1024.0));
+  return true;
 }
 
 void LoaderAlov::get_videos(const bool get_train, std::vector<Video>* videos) const {
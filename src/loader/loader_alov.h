@@ -16,9 +16,20 @@
 class LoaderAlov : public VideoLoader
 {
 public:
-  // Loads all annotations.
+  // Loads all annotations.  The videos are read from the manifest of the
+  // annotations folder if it is up to date (see ManifestFile); otherwise they
+  // are parsed and the manifest is saved for the next time.
   LoaderAlov(const std::string& images, const std::string& annotations);
 
+  // Load all annotations from a dataset that was packed with SaveShards;
+  // the frames are then read from the memory-mapped shards.
+  explicit LoaderAlov(const std::string& shard_prefix);
+
+  // Pack all frames of all videos, with their annotations, into shards with
+  // the given prefix (see ShardWriter for max_image_size).  Returns false on
+  // failure.
+  bool SaveShards(const std::string& shard_prefix, const int max_image_size) const;
+
   // If get_train is true, get the videos in the training set; otherwise,
   // get the videos in the validation set.
   // The training videos (as well as the validation videos) are taken
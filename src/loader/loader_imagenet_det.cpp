@@ -1,8 +1,13 @@
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
 #include <tinyxml.h>
 
 #include "train/example_generator.h"
 #include "loader/loader_imagenet_det.h"
 #include "helper/helper.h"
+#include "helper/image_decode.h"
 
 using std::vector;
 using std::string;
@@ -12,11 +17,18 @@ namespace bfs = boost::filesystem;
 // If true, only load a small number of images.
 const bool kDoTest = false;
 
+// Number of folder levels in the annotations folder (the annotation files are
+// in its subfolders).
+const int kAnnotationsFolderDepth = 1;
+
 // Max ratio of bbox size to image size that we load.
 // If the ratio is too large (i.e. the object occupies almost the entire image),
 // then we will not be able to simulate object motion.
 const double kMaxRatio = 0.66;
 
+// Number of threads per core that parse the annotation files.
+const int kParseThreadsPerCore = 2;
+
 LoaderImagenetDet::LoaderImagenetDet(const std::string& image_folder,
                                      const std::string& annotations_folder)
   : path_(image_folder)
@@ -26,63 +38,296 @@ LoaderImagenetDet::LoaderImagenetDet(const std::string& image_folder,
     return;
   }
 
+  // Load the annotations from the manifest, if it is newer than the annotations.
+  const string& manifest_file = ManifestFile(annotations_folder);
+  const string& sources = "imagenet_det " + annotations_folder;
+  if (LoadManifest(manifest_file, sources,
+                   GetNewestFolderTime(annotations_folder, kAnnotationsFolderDepth))) {
+    return;
+  }
+
   // Find all image subfolders.
   vector<string> subfolders;
   find_subfolders(annotations_folder, &subfolders);
 
-  size_t num_annotations = 0;
+  const size_t max_subfolders = kDoTest ? 1 : subfolders.size();
 
-  const int max_subfolders = kDoTest ? 1 : subfolders.size();
+  // Parse the subfolders on a pool of threads.  Parsing is mostly waiting for
+  // small reads, so there are more threads than cores, to keep several reads
+  // in flight.
+  const int num_threads = std::max<int>(1, std::min<size_t>(
+      max_subfolders, kParseThreadsPerCore * std::thread::hardware_concurrency()));
 
   printf("Found %zu subfolders...\n", subfolders.size());
-  printf("Loading images, please wait...\n");
+  printf("Loading images on %d threads, please wait...\n", num_threads);
+
+  // Each thread takes the next subfolder that has not been parsed yet.  The
+  // images of each subfolder are kept apart, and appended in the order of the
+  // subfolders once all are parsed, so that the images are in the same order
+  // as if they were parsed one subfolder at a time.
+  vector<vector<vector<Annotation> > > subfolder_images(max_subfolders);
+  std::atomic<size_t> next_subfolder(0);
+  std::atomic<size_t> num_loaded(0);
+  auto parse_subfolders = [&]() {
+    while (true) {
+      const size_t i = next_subfolder++;
+      if (i >= max_subfolders) {
+        break;
+      }
+      LoadSubfolder(annotations_folder + "/" + subfolders[i], &subfolder_images[i]);
+
+      // Every 10 subfolders, print an update.
+      const size_t loaded = ++num_loaded;
+      if (loaded % 10 == 0) {
+        printf("Loaded %zu subfolders\n", loaded);
+      }
+    }
+  };
+  vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(std::thread(parse_subfolders));
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    threads[i].join();
+  }
 
-  // Iterate over all subfolders.
+  // Save the annotations of all subfolders, in order.
+  size_t num_annotations = 0;
   for (size_t i = 0; i < max_subfolders; ++i) {
-    // Every 100 iterations, print an update.
-    if (i % 10 == 0 && i > 0) {
-      printf("Loaded %zu subfolders\n", i);
+    vector<vector<Annotation> >& images = subfolder_images[i];
+    for (size_t j = 0; j < images.size(); ++j) {
+      num_annotations += images[j].size();
+      images_.push_back(std::move(images[j]));
     }
-    const string& subfolder_name = subfolders[i];
-    const string& subfolder_path = annotations_folder + "/" + subfolder_name;
+  }
+  printf("Found %zu annotations from %zu images\n", num_annotations, images_.size());
 
-    //printf("Loading subfolder: %s\n", subfolder_name.c_str());
+  // Save the annotations, so that they need not be parsed the next time.
+  if (!kDoTest) {
+    SaveManifest(manifest_file, sources);
+  }
+}
 
-    // Find the annotation files.
-    const boost::regex annotation_filter(".*\\.xml");
-    vector<string> annotation_files;
-    find_matching_files(subfolder_path, annotation_filter, &annotation_files);
+LoaderImagenetDet::LoaderImagenetDet(const std::string& shard_prefix)
+  : path_(shard_prefix)
+{
+  const string& index_file = ShardIndexFile(shard_prefix);
+  FILE* index_file_ptr = fopen(index_file.c_str(), "r");
+  if (!index_file_ptr) {
+    printf("Error - could not open shard index %s\n", index_file.c_str());
+    return;
+  }
 
-    //printf("Found %zu annotations\n", annotation_files.size());
+  printf("Loading images from shards %s\n", shard_prefix.c_str());
 
-    // Iterate over all annotation files.
-    for (size_t j = 0; j < annotation_files.size(); ++j) {
-      const string& annotation_file = annotation_files[j];
+  size_t num_images;
+  if (fscanf(index_file_ptr, "imagenet_det %zu\n", &num_images) != 1) {
+    printf("Error - %s is not an ImageNet shard index\n", index_file.c_str());
+    fclose(index_file_ptr);
+    return;
+  }
 
-      const string& full_path = subfolder_path + "/" + annotation_file;
+  // Read the annotations and the location of each image.
+  size_t num_annotations = 0;
+  images_.resize(num_images);
+  records_.resize(num_images);
+  char image_path[1024];
+  for (size_t i = 0; i < num_images; ++i) {
+    int image_annotations;
+    bool truncated = fscanf(index_file_ptr, "%1023s %d ", image_path, &image_annotations) != 2 ||
+                     image_annotations < 0 ||
+                     !ReadShardRecord(index_file_ptr, &records_[i]);
+
+    if (!truncated) {
+      std::vector<Annotation>& annotations = images_[i];
+      annotations.resize(image_annotations);
+      for (int j = 0; j < image_annotations; ++j) {
+        Annotation& annotation = annotations[j];
+        annotation.image_path = image_path;
+        if (fscanf(index_file_ptr, "%lf %lf %lf %lf %d %d\n",
+                   &annotation.bbox.x1_, &annotation.bbox.y1_,
+                   &annotation.bbox.x2_, &annotation.bbox.y2_,
+                   &annotation.display_width_, &annotation.display_height_) != 6) {
+          truncated = true;
+          break;
+        }
+      }
+    }
 
-      // Read the annotations.
-      //printf("Processing annotation file: %s\n", full_path.c_str());
-      vector<Annotation> annotations;
-      LoadAnnotationFile(full_path, &annotations);
+    if (truncated) {
+      printf("Error - truncated shard index %s\n", index_file.c_str());
+      images_.resize(i);
+      records_.resize(i);
+      break;
+    }
+    num_annotations += image_annotations;
+  }
+  fclose(index_file_ptr);
 
-      if (annotations.size() == 0) {
-        continue;
-      }
+  // Map the shards.
+  shard_reader_.reset(new ShardReader);
+  if (!shard_reader_->Open(shard_prefix)) {
+    images_.clear();
+    records_.clear();
+    return;
+  }
+
+  printf("Found %zu annotations from %zu images\n", num_annotations, images_.size());
+}
+
+bool LoaderImagenetDet::SaveShards(const std::string& shard_prefix,
+                                   const int max_image_size) const {
+  if (shard_reader_) {
+    printf("Error - cannot repack images that were loaded from shards\n");
+    return false;
+  }
+
+  const string& index_file = ShardIndexFile(shard_prefix);
+  FILE* index_file_ptr = fopen(index_file.c_str(), "w");
+  if (!index_file_ptr) {
+    printf("Error - could not open shard index %s\n", index_file.c_str());
+    return false;
+  }
+
+  ShardWriter shard_writer(shard_prefix, max_image_size);
+
+  // Skip the images that cannot be read, so count them first.
+  std::vector<ShardRecord> records(images_.size());
+  std::vector<double> scales(images_.size());
+  std::vector<bool> valid(images_.size());
+  size_t num_valid = 0;
+  for (size_t i = 0; i < images_.size(); ++i) {
+    if (i % 10000 == 0 && i > 0) {
+      printf("Packed %zu of %zu images\n", i, images_.size());
+    }
+    const string& image_file = path_ + "/" + images_[i][0].image_path + ".JPEG";
+    valid[i] = shard_writer.AddImage(image_file, &records[i], &scales[i]);
+    if (valid[i]) {
+      num_valid++;
+    }
+  }
+  shard_writer.Close();
+
+  // The index would point at missing bytes.
+  if (shard_writer.get_write_failed()) {
+    printf("Error - could not write shards %s\n", shard_prefix.c_str());
+    fclose(index_file_ptr);
+    remove(index_file.c_str());
+    return false;
+  }
+
+  // Write the index; the annotations are scaled with their images.
+  fprintf(index_file_ptr, "imagenet_det %zu\n", num_valid);
+  for (size_t i = 0; i < images_.size(); ++i) {
+    if (!valid[i]) {
+      continue;
+    }
+    const std::vector<Annotation>& annotations = images_[i];
+    fprintf(index_file_ptr, "%s %zu ", annotations[0].image_path.c_str(), annotations.size());
+    WriteShardRecord(records[i], index_file_ptr);
+
+    const double scale = scales[i];
+    for (size_t j = 0; j < annotations.size(); ++j) {
+      const Annotation& annotation = annotations[j];
+      fprintf(index_file_ptr, "%lf %lf %lf %lf %d %d\n",
+              annotation.bbox.x1_ * scale, annotation.bbox.y1_ * scale,
+              annotation.bbox.x2_ * scale, annotation.bbox.y2_ * scale,
+              static_cast<int>(round(annotation.display_width_ * scale)),
+              static_cast<int>(round(annotation.display_height_ * scale)));
+    }
+  }
+  fclose(index_file_ptr);
+
+  printf("Packed %zu images into %.1lf MB of shards\n", num_valid,
+         shard_writer.get_bytes_written() / (1024.0 * 1024.0));
+  return true;
+}
+
+bool LoaderImagenetDet::LoadManifest(const string& manifest_file, const string& sources,
+                                     const time_t newest_source_time) {
+  ManifestReader manifest;
+  if (!manifest.Open(manifest_file, sources, newest_source_time)) {
+    return false;
+  }
 
-      // Count the number of annotations.
-      //printf("Found %zu annotations\n", annotations.size());
+  printf("Loading annotations from %s\n", manifest_file.c_str());
+
+  // Each image is a sequence of the manifest, with the image path as its path.
+  size_t num_annotations = 0;
+  for (size_t i = 0; i < manifest.get_num_groups(); ++i) {
+    size_t first_image;
+    size_t last_image;
+    manifest.GetGroupSequences(i, &first_image, &last_image);
+    for (size_t j = first_image; j < last_image; ++j) {
+      const string image_path = manifest.GetSequencePath(j);
+      size_t first_annotation;
+      size_t last_annotation;
+      manifest.GetSequenceAnnotations(j, &first_annotation, &last_annotation);
+
+      images_.push_back(vector<Annotation>(last_annotation - first_annotation));
+      vector<Annotation>& annotations = images_.back();
+      for (size_t k = first_annotation; k < last_annotation; ++k) {
+        Annotation& annotation = annotations[k - first_annotation];
+        annotation.image_path = image_path;
+        int frame_num;
+        manifest.GetAnnotation(k, &frame_num, &annotation.bbox,
+                               &annotation.display_width_, &annotation.display_height_);
+      }
       num_annotations += annotations.size();
+    }
+  }
 
-      // Save the annotations.
-      images_.push_back(annotations);
-    } // Process all annotations in a subfolder.
-  } // Process all subfolders.
   printf("Found %zu annotations from %zu images\n", num_annotations, images_.size());
+  return true;
+}
+
+void LoaderImagenetDet::SaveManifest(const string& manifest_file, const string& sources) const {
+  ManifestWriter manifest;
+  for (size_t i = 0; i < images_.size(); ++i) {
+    const vector<Annotation>& annotations = images_[i];
+    manifest.AddSequence(annotations[0].image_path);
+    for (size_t j = 0; j < annotations.size(); ++j) {
+      const Annotation& annotation = annotations[j];
+      manifest.AddAnnotation(0, annotation.bbox, annotation.display_width_,
+                             annotation.display_height_);
+    }
+  }
+  if (manifest.Write(manifest_file, sources)) {
+    printf("Saved the annotations to %s\n", manifest_file.c_str());
+  }
+}
+
+void LoaderImagenetDet::LoadSubfolder(const string& subfolder_path,
+                                      vector<vector<Annotation> >* images) const {
+  // Find the annotation files.
+  const boost::regex annotation_filter(".*\\.xml");
+  vector<string> annotation_files;
+  find_matching_files(subfolder_path, annotation_filter, &annotation_files);
+
+  //printf("Found %zu annotations\n", annotation_files.size());
+
+  // Iterate over all annotation files.
+  for (size_t j = 0; j < annotation_files.size(); ++j) {
+    const string& annotation_file = annotation_files[j];
+
+    const string& full_path = subfolder_path + "/" + annotation_file;
+
+    // Read the annotations.
+    //printf("Processing annotation file: %s\n", full_path.c_str());
+    vector<Annotation> annotations;
+    LoadAnnotationFile(full_path, &annotations);
+
+    if (annotations.size() == 0) {
+      continue;
+    }
+
+    // Save the annotations.
+    images->push_back(annotations);
+  } // Process all annotations in a subfolder.
 }
 
 void LoaderImagenetDet::LoadAnnotationFile(const string& annotation_file,
-                                           vector<Annotation>* image_annotations) {
+                                           vector<Annotation>* image_annotations) const {
   // Open the annotation file.
   TiXmlDocument document(annotation_file.c_str());
   document.LoadFile();
@@ -289,38 +534,57 @@ void LoaderImagenetDet::LoadImage(const size_t image_num,
   const Annotation& annotation = annotations[annotation_num];
 
   // Load the specified image (using the file-path contained within the annotation).
-  const string& image_file = path_ + "/" + annotation.image_path + ".JPEG";
-  *image = cv::imread(image_file.c_str());
+  ReadImage(image_num, 1, image);
 
   // Check that we were able to load the image.
   if (!image->data) {
-    printf("Could not open or find image %s\n", image_file.c_str());
+    printf("Could not open or find image %s\n", annotation.image_path.c_str());
     return;
   }
 }
 
+int LoaderImagenetDet::ReadImage(const size_t image_num, const int reduction,
+                                 cv::Mat* image) const {
+  if (shard_reader_) {
+    return shard_reader_->ReadImage(records_[image_num], reduction, image);
+  }
+
+  const string& image_file = path_ + "/" + images_[image_num][0].image_path + ".JPEG";
+  return ReadImageReduced(image_file, reduction, image);
+}
+
 void LoaderImagenetDet::LoadAnnotation(const size_t image_num,
                                        const size_t annotation_num,
                                        cv::Mat* image,
                                        BoundingBox* bbox) const {
+  LoadAnnotation(image_num, annotation_num, 1, image, bbox);
+}
+
+int LoaderImagenetDet::LoadAnnotation(const size_t image_num,
+                                       const size_t annotation_num,
+                                       const int reduction,
+                                       cv::Mat* image,
+                                       BoundingBox* bbox) const {
   // Load the specified image's annotations.
   const std::vector<Annotation>& annotations = images_[image_num];
   const Annotation& annotation = annotations[annotation_num];
 
-  // Load the specified image.
-  const string& image_file = path_ + "/" + annotation.image_path + ".JPEG";
-  *image = cv::imread(image_file.c_str());
+  // Load the specified image, decoded at the requested reduction (if possible).
+  const string& image_file = annotation.image_path;
+  const int actual_reduction = ReadImage(image_num, reduction, image);
 
   // Check that we were able to load the image.
   if (!image->data) {
     printf("Could not open or find image %s\n", image_file.c_str());
-    return;
+    return 1;
   }
 
   // Check if the dispay width / height differs from the image width / height (the image may have been
-  // downsampled for visualization).  Usually this value will be 1.
-  double factor = 1;
-  if (image->rows != annotation.display_height_ || image->cols != annotation.display_width_) {
+  // downsampled for visualization).  Usually this value will be 1.  A reduced decode rounds the image
+  // size up, so the full size is only known to within the reduction.
+  double factor = 1.0 / actual_reduction;
+  if (std::abs(image->rows * actual_reduction - annotation.display_height_) >= actual_reduction ||
+      std::abs(image->cols * actual_reduction - annotation.display_width_) >= actual_reduction) {
     printf("Image: %zu %zu %s\n", image_num, annotation_num, image_file.c_str());
     printf("Image size: %d %d\n", image->rows, image->cols);
     printf("Display size: %d %d\n", annotation.display_height_,
@@ -338,6 +602,8 @@ void LoaderImagenetDet::LoadAnnotation(const size_t image_num,
   bbox->x2_ *= factor;
   bbox->y1_ *= factor;
   bbox->y2_ *= factor;
+
+  return actual_reduction;
 }
 
 void LoaderImagenetDet::ShowAnnotationsRand() const {
@@ -1,7 +1,11 @@
 #ifndef LOADER_IMAGENET_DET_H
 #define LOADER_IMAGENET_DET_H
 
+#include <boost/shared_ptr.hpp>
+
 #include "helper/bounding_box.h"
+#include "loader/manifest.h"
+#include "loader/shard.h"
 
 // An image annotation.
 struct Annotation {
@@ -20,10 +24,20 @@ struct Annotation {
 class LoaderImagenetDet
 {
 public:
-  // Load all annotations.
+  // Load all annotations.  The annotations are read from the manifest of the
+  // annotations folder if it is up to date (see ManifestFile); otherwise they
+  // are parsed and the manifest is saved for the next time.
   LoaderImagenetDet(const std::string& image_folder,
                     const std::string& annotations_folder);
 
+  // Load all annotations from a dataset that was packed with SaveShards;
+  // the images are then read from the memory-mapped shards.
+  explicit LoaderImagenetDet(const std::string& shard_prefix);
+
+  // Pack all images, with their annotations, into shards with the given prefix
+  // (see ShardWriter for max_image_size).  Returns false on failure.
+  bool SaveShards(const std::string& shard_prefix, const int max_image_size) const;
+
   // Load the specified image.
   void LoadImage(const size_t image_num, cv::Mat* image) const;
 
@@ -33,6 +47,15 @@ public:
                       cv::Mat* image,
                       BoundingBox* bbox) const;
 
+  // Get the annotation and the image, with the image decoded at 1/reduction of
+  // its size (see ReadImageReduced) and the bounding box in the coordinates of
+  // the decoded image.  Returns the reduction that was applied.
+  int LoadAnnotation(const size_t image_num,
+                      const size_t annotation_num,
+                      const int reduction,
+                      cv::Mat* image,
+                      BoundingBox* bbox) const;
+
   // Show just the images (no annotations).
   void ShowImages() const;
 
@@ -54,15 +77,37 @@ public:
   }
 
 private:
+  // Read the image for the given image number (from the shards, if loaded
+  // from shards), at 1/reduction of its size.  Returns the reduction that was
+  // applied.
+  int ReadImage(const size_t image_num, const int reduction, cv::Mat* image) const;
+
+  // Load the annotations from the manifest, if it is up to date.  Returns
+  // false if the annotations must be parsed instead.
+  bool LoadManifest(const std::string& manifest_file, const std::string& sources,
+                    const time_t newest_source_time);
+
+  // Save the annotations to the manifest.
+  void SaveManifest(const std::string& manifest_file, const std::string& sources) const;
+
+  // Read the annotation files of the subfolder, adding the annotations of each
+  // image (that has any) to images.  Thread-safe.
+  void LoadSubfolder(const std::string& subfolder_path,
+                     std::vector<std::vector<Annotation> >* images) const;
+
   // Read the annotation file, convert to bounding box format, and save.
   void LoadAnnotationFile(const std::string& annotation_file,
-                          std::vector<Annotation>* image_annotations);
+                          std::vector<Annotation>* image_annotations) const;
 
   // Path to the folder containing the image files.
   std::string path_;
 
   // All annotations for all images.
   std::vector<std::vector<Annotation> > images_;
+
+  // If loaded from shards, the shards and the location of each image.
+  boost::shared_ptr<ShardReader> shard_reader_;
+  std::vector<ShardRecord> records_;
 };
 
 #endif // LOADER_IMAGENET_DET_H
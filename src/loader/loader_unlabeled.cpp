@@ -0,0 +1,134 @@
+#include "loader_unlabeled.h"
+
+#include <algorithm>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+
+using std::string;
+using std::vector;
+namespace bfs = boost::filesystem;
+
+// Number of consecutive images that a stream reads before moving on to another
+// random run of images.
+const size_t kImagesPerRun = 100;
+
+// Number of times to try to open a source that has a frame, before giving up
+// (e.g. if some of the videos cannot be read).
+const int kMaxOpenAttempts = 10;
+
+namespace {
+
+bool IsImageExtension(const string& extension) {
+  return extension == ".jpg" || extension == ".jpeg" || extension == ".png" ||
+         extension == ".bmp" || extension == ".ppm";
+}
+
+bool IsVideoExtension(const string& extension) {
+  return extension == ".avi" || extension == ".mp4" || extension == ".mkv" ||
+         extension == ".mov" || extension == ".webm";
+}
+
+} // namespace
+
+LoaderUnlabeled::LoaderUnlabeled(const string& folder, const int num_streams,
+                                 const int frame_stride)
+  : frame_stride_(std::max(1, frame_stride))
+{
+  if (!bfs::is_directory(folder)) {
+    printf("Error - %s is not a valid directory!\n", folder.c_str());
+    return;
+  }
+
+  // Find all images and videos.
+  bfs::recursive_directory_iterator end_itr;
+  for (bfs::recursive_directory_iterator itr(folder); itr != end_itr; ++itr) {
+    if (!bfs::is_regular_file(itr->status())) {
+      continue;
+    }
+    const string extension = boost::algorithm::to_lower_copy(itr->path().extension().string());
+    if (IsImageExtension(extension)) {
+      image_files_.push_back(itr->path().string());
+    } else if (IsVideoExtension(extension)) {
+      video_files_.push_back(itr->path().string());
+    }
+  }
+
+  // Sort the files by name, so that consecutive images (e.g. the frames of a
+  // recording) are read in order.
+  std::sort(image_files_.begin(), image_files_.end());
+  std::sort(video_files_.begin(), video_files_.end());
+
+  printf("Found %zu images and %zu videos in %s\n", image_files_.size(), video_files_.size(),
+         folder.c_str());
+
+  for (int i = 0; i < num_streams; ++i) {
+    streams_.push_back(boost::shared_ptr<Stream>(new Stream));
+  }
+}
+
+bool LoaderUnlabeled::ReadFrame(Rng* rng, cv::Mat* frame) {
+  if (streams_.empty() || (image_files_.empty() && video_files_.empty())) {
+    return false;
+  }
+
+  Stream* stream = streams_[rng->UniformInt(streams_.size())].get();
+  std::lock_guard<std::mutex> lock(stream->mutex);
+  if (ReadNext(stream, frame)) {
+    return true;
+  }
+
+  // The source is finished (or was never opened), so move on to another one.
+  for (int i = 0; i < kMaxOpenAttempts; ++i) {
+    OpenRandomSource(rng, stream);
+    if (ReadNext(stream, frame)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LoaderUnlabeled::ReadNext(Stream* stream, cv::Mat* frame) const {
+  if (stream->capture.isOpened()) {
+    // Skip the frames in between without converting them.
+    for (int i = 1; i < frame_stride_; ++i) {
+      if (!stream->capture.grab()) {
+        stream->capture.release();
+        return false;
+      }
+    }
+    if (!stream->capture.read(*frame) || frame->empty()) {
+      stream->capture.release();
+      return false;
+    }
+    return true;
+  }
+
+  // Skip images that cannot be read.
+  while (stream->next_image < stream->end_image) {
+    *frame = cv::imread(image_files_[stream->next_image++]);
+    if (!frame->empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LoaderUnlabeled::OpenRandomSource(Rng* rng, Stream* stream) const {
+  stream->capture.release();
+  stream->next_image = 0;
+  stream->end_image = 0;
+
+  // Each video and each run of images is equally likely.
+  const size_t num_runs = (image_files_.size() + kImagesPerRun - 1) / kImagesPerRun;
+  const size_t source = rng->UniformInt(video_files_.size() + num_runs);
+  if (source < video_files_.size()) {
+    stream->capture.open(video_files_[source]);
+    if (!stream->capture.isOpened()) {
+      printf("Error - could not open video %s\n", video_files_[source].c_str());
+    }
+  } else {
+    stream->next_image = (source - video_files_.size()) * kImagesPerRun;
+    stream->end_image = std::min(stream->next_image + kImagesPerRun, image_files_.size());
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef LOADER_UNLABELED_H
+#define LOADER_UNLABELED_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "helper/rng.h"
+
+// Loads frames from a folder of unlabeled images and videos (e.g. robot
+// footage), for self-supervised pretraining.
+//
+// To read large folders at disk speed, the frames are read sequentially: each
+// of several streams reads a source (a video file, or a run of consecutive
+// image files) from start to end, and then moves on to another random source.
+// Frames are taken from a random stream each time, so that consecutive frames
+// are spread over many sources.
+//
+// ReadFrame is thread-safe.  Since the streams are shared between threads,
+// the sequence of frames depends on the timing of the threads.
+class LoaderUnlabeled
+{
+public:
+  // Find all images and videos in folder and its subfolders, to be read by
+  // num_streams streams (at least the number of threads reading frames, so
+  // that they rarely wait for each other).  Only every frame_stride-th frame
+  // of each video is returned, since nearby frames are nearly identical.
+  LoaderUnlabeled(const std::string& folder, const int num_streams, const int frame_stride);
+
+  // Read the next frame of a random stream.  Returns false if no frame could
+  // be read (e.g. there are no images or videos).
+  bool ReadFrame(Rng* rng, cv::Mat* frame);
+
+  size_t get_num_images() const { return image_files_.size(); }
+  size_t get_num_videos() const { return video_files_.size(); }
+
+private:
+  // A source being read.
+  struct Stream {
+    Stream() : next_image(0), end_image(0) {}
+
+    std::mutex mutex;
+
+    // The video being read, if any.
+    cv::VideoCapture capture;
+
+    // Otherwise, the images [next_image, end_image) remain to be read.
+    size_t next_image;
+    size_t end_image;
+  };
+
+  // Read the next frame of the stream's source.  Returns false at the end of the source.
+  bool ReadNext(Stream* stream, cv::Mat* frame) const;
+
+  // Start reading a random source with the stream.
+  void OpenRandomSource(Rng* rng, Stream* stream) const;
+
+  // Sorted paths of all image and video files.
+  std::vector<std::string> image_files_;
+  std::vector<std::string> video_files_;
+
+  int frame_stride_;
+
+  std::vector<boost::shared_ptr<Stream> > streams_;
+};
+
+#endif // LOADER_UNLABELED_H
@@ -12,6 +12,9 @@ namespace bfs = boost::filesystem;
 
 const bool kDoTest = false;
 
+// Number of folder levels in the VOT folder (video/frame.jpg).
+const int kVOTFolderDepth = 1;
+
 LoaderVOT::LoaderVOT(const std::string& vot_folder)
 {
   if (!bfs::is_directory(vot_folder)) {
@@ -19,6 +22,14 @@ LoaderVOT::LoaderVOT(const std::string& vot_folder)
     return;
   }
 
+  // Load the videos from the manifest, if it is newer than the folder.
+  const string& manifest_file = ManifestFile(vot_folder);
+  const string& sources = "vot " + vot_folder;
+  if (LoadManifest(manifest_file, sources, GetNewestFolderTime(vot_folder, kVOTFolderDepth),
+                   NULL)) {
+    return;
+  }
+
   // Find all video subcategories.
   vector<string> videos;
   find_subfolders(vot_folder, &videos);
@@ -68,4 +79,9 @@ LoaderVOT::LoaderVOT(const std::string& vot_folder)
     fclose(bbox_groundtruth_file_ptr);
     videos_.push_back(video);
   } // Process all videos
+
+  // Save the videos, so that they need not be parsed the next time.
+  std::vector<Category> categories(1);
+  categories[0].videos = videos_;
+  SaveManifest(manifest_file, sources, categories);
 }
@@ -7,7 +7,9 @@
 class LoaderVOT : public VideoLoader
 {
 public:
-  // Loads all images and annotations.
+  // Loads all images and annotations.  The videos are read from the manifest
+  // of the folder if it is up to date (see ManifestFile); otherwise they are
+  // parsed and the manifest is saved for the next time.
   LoaderVOT(const std::string& vot_folder);
 };
 
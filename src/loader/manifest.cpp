@@ -0,0 +1,322 @@
+#include "manifest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+using std::string;
+using std::vector;
+namespace bfs = boost::filesystem;
+
+namespace {
+
+const char kManifestMagic[8] = {'G', 'O', 'T', 'M', 'A', 'N', 'F', 'T'};
+
+// Increase when the format changes, or when the loaders change what they
+// store (e.g. which annotations they skip), so that old manifests are rebuilt.
+const uint32_t kManifestVersion = 1;
+
+// Each array in the file starts at a multiple of this.
+const size_t kArrayAlignment = 8;
+
+struct ManifestHeader {
+  char magic[8];
+  uint32_t version;
+
+  // Index of the string that describes the sources of the manifest.
+  uint32_t sources;
+
+  uint64_t num_groups;
+  uint64_t num_sequences;
+  uint64_t num_frames;
+  uint64_t num_annotations;
+  uint64_t num_strings;
+  uint64_t string_bytes;
+};
+
+size_t AlignedSize(const size_t size) {
+  return (size + kArrayAlignment - 1) / kArrayAlignment * kArrayAlignment;
+}
+
+// Write the array, padded to the alignment.
+template <typename T>
+bool WriteArray(const T* values, const size_t count, FILE* file) {
+  const size_t size = count * sizeof(T);
+  const char padding[kArrayAlignment] = {0};
+  return fwrite(values, 1, size, file) == size &&
+         fwrite(padding, 1, AlignedSize(size) - size, file) == AlignedSize(size) - size;
+}
+
+template <typename T>
+bool WriteArray(const vector<T>& values, FILE* file) {
+  return WriteArray(values.data(), values.size(), file);
+}
+
+// Point the array at the next position of the mapped file, and move past it.
+template <typename T>
+void MapArray(const size_t count, const char** position, const T** array) {
+  *array = reinterpret_cast<const T*>(*position);
+  *position += AlignedSize(count * sizeof(T));
+}
+
+} // namespace
+
+string ManifestFile(const string& folder) {
+  string name = folder;
+  while (name.size() > 1 && name[name.size() - 1] == '/') {
+    name.erase(name.size() - 1);
+  }
+  return name + ".manifest";
+}
+
+time_t GetNewestFolderTime(const string& folder, const int depth) {
+  time_t newest = bfs::last_write_time(folder);
+  if (depth > 0) {
+    bfs::directory_iterator end_itr;
+    for (bfs::directory_iterator itr(folder); itr != end_itr; ++itr) {
+      if (bfs::is_directory(itr->status())) {
+        newest = std::max(newest, GetNewestFolderTime(itr->path().string(), depth - 1));
+      }
+    }
+  }
+  return newest;
+}
+
+ManifestWriter::ManifestWriter() {
+}
+
+void ManifestWriter::AddGroup() {
+  group_offsets_.push_back(sequence_paths_.size());
+}
+
+void ManifestWriter::AddSequence(const string& path) {
+  if (group_offsets_.empty()) {
+    AddGroup();
+  }
+  sequence_paths_.push_back(AddString(path));
+  frame_offsets_.push_back(frame_names_.size());
+  annotation_offsets_.push_back(annotation_frames_.size());
+}
+
+void ManifestWriter::AddFrame(const string& name) {
+  frame_names_.push_back(AddString(name));
+}
+
+void ManifestWriter::AddAnnotation(const int frame_num, const BoundingBox& bbox,
+                                   const int display_width, const int display_height) {
+  annotation_frames_.push_back(frame_num);
+  annotation_sizes_.push_back(display_width);
+  annotation_sizes_.push_back(display_height);
+  annotation_boxes_.push_back(bbox.x1_);
+  annotation_boxes_.push_back(bbox.y1_);
+  annotation_boxes_.push_back(bbox.x2_);
+  annotation_boxes_.push_back(bbox.y2_);
+}
+
+uint32_t ManifestWriter::AddString(const string& value) {
+  std::unordered_map<string, uint32_t>::const_iterator itr = string_indices_.find(value);
+  if (itr != string_indices_.end()) {
+    return itr->second;
+  }
+  const uint32_t index = string_offsets_.size();
+  string_offsets_.push_back(string_data_.size());
+  string_data_.append(value.c_str(), value.size() + 1);
+  string_indices_[value] = index;
+  return index;
+}
+
+bool ManifestWriter::Write(const string& manifest_file, const string& sources) const {
+  // Each list of offsets ends with the total count.
+  vector<uint64_t> group_offsets = group_offsets_;
+  group_offsets.push_back(sequence_paths_.size());
+  vector<uint64_t> frame_offsets = frame_offsets_;
+  frame_offsets.push_back(frame_names_.size());
+  vector<uint64_t> annotation_offsets = annotation_offsets_;
+  annotation_offsets.push_back(annotation_frames_.size());
+
+  // The sources are the last string.
+  vector<uint64_t> string_offsets = string_offsets_;
+  string_offsets.push_back(string_data_.size());
+  string_offsets.push_back(string_data_.size() + sources.size() + 1);
+
+  ManifestHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kManifestMagic, sizeof(header.magic));
+  header.version = kManifestVersion;
+  header.sources = string_offsets_.size();
+  header.num_groups = group_offsets_.size();
+  header.num_sequences = sequence_paths_.size();
+  header.num_frames = frame_names_.size();
+  header.num_annotations = annotation_frames_.size();
+  header.num_strings = string_offsets.size() - 1;
+  header.string_bytes = string_offsets.back();
+
+  const string temp_file = manifest_file + ".tmp";
+  FILE* file = fopen(temp_file.c_str(), "wb");
+  if (!file) {
+    printf("Could not open manifest for writing: %s\n", temp_file.c_str());
+    return false;
+  }
+  bool ok = WriteArray(&header, 1, file) &&
+            WriteArray(group_offsets, file) &&
+            WriteArray(sequence_paths_, file) &&
+            WriteArray(frame_offsets, file) &&
+            WriteArray(annotation_offsets, file) &&
+            WriteArray(frame_names_, file) &&
+            WriteArray(annotation_frames_, file) &&
+            WriteArray(annotation_sizes_, file) &&
+            WriteArray(annotation_boxes_, file) &&
+            WriteArray(string_offsets, file) &&
+            fwrite(string_data_.data(), 1, string_data_.size(), file) == string_data_.size() &&
+            fwrite(sources.c_str(), 1, sources.size() + 1, file) == sources.size() + 1;
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temp_file.c_str(), manifest_file.c_str()) != 0) {
+    printf("Could not write manifest: %s\n", manifest_file.c_str());
+    remove(temp_file.c_str());
+    return false;
+  }
+  return true;
+}
+
+ManifestReader::ManifestReader()
+  : data_(NULL),
+    size_(0),
+    num_groups_(0)
+{
+}
+
+ManifestReader::~ManifestReader() {
+  Close();
+}
+
+bool ManifestReader::Open(const string& manifest_file, const string& sources,
+                          const time_t newest_source_time) {
+  Close();
+
+  const int fd = open(manifest_file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_mtime <= newest_source_time ||
+      static_cast<size_t>(st.st_size) < sizeof(ManifestHeader)) {
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    printf("Could not map manifest: %s\n", manifest_file.c_str());
+    return false;
+  }
+  data_ = static_cast<char*>(data);
+  size_ = st.st_size;
+
+  // The whole manifest is read once, in order.
+  madvise(data_, size_, MADV_SEQUENTIAL);
+
+  const ManifestHeader* header = reinterpret_cast<const ManifestHeader*>(data_);
+  if (memcmp(header->magic, kManifestMagic, sizeof(header->magic)) != 0 ||
+      header->version != kManifestVersion) {
+    Close();
+    return false;
+  }
+
+  // Find the arrays, checking that they are all within the file.
+  const size_t expected_size =
+      AlignedSize(sizeof(ManifestHeader)) +
+      AlignedSize((header->num_groups + 1) * sizeof(uint64_t)) +
+      AlignedSize(header->num_sequences * sizeof(uint32_t)) +
+      2 * AlignedSize((header->num_sequences + 1) * sizeof(uint64_t)) +
+      AlignedSize(header->num_frames * sizeof(uint32_t)) +
+      AlignedSize(header->num_annotations * sizeof(int32_t)) +
+      AlignedSize(2 * header->num_annotations * sizeof(int32_t)) +
+      AlignedSize(4 * header->num_annotations * sizeof(double)) +
+      AlignedSize((header->num_strings + 1) * sizeof(uint64_t)) +
+      header->string_bytes;
+  if (expected_size != size_ || header->sources >= header->num_strings) {
+    printf("Invalid manifest: %s\n", manifest_file.c_str());
+    Close();
+    return false;
+  }
+
+  const char* position = data_ + AlignedSize(sizeof(ManifestHeader));
+  MapArray(header->num_groups + 1, &position, &group_offsets_);
+  MapArray(header->num_sequences, &position, &sequence_paths_);
+  MapArray(header->num_sequences + 1, &position, &frame_offsets_);
+  MapArray(header->num_sequences + 1, &position, &annotation_offsets_);
+  MapArray(header->num_frames, &position, &frame_names_);
+  MapArray(header->num_annotations, &position, &annotation_frames_);
+  MapArray(2 * header->num_annotations, &position, &annotation_sizes_);
+  MapArray(4 * header->num_annotations, &position, &annotation_boxes_);
+  MapArray(header->num_strings + 1, &position, &string_offsets_);
+  string_data_ = position;
+  num_groups_ = header->num_groups;
+
+  // The manifest must have been built from the same folders.
+  if (sources != GetString(header->sources)) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void ManifestReader::Close() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+  data_ = NULL;
+  size_ = 0;
+  num_groups_ = 0;
+}
+
+const char* ManifestReader::GetString(const uint32_t index) const {
+  return string_data_ + string_offsets_[index];
+}
+
+void ManifestReader::GetGroupSequences(const size_t group, size_t* first, size_t* last) const {
+  *first = group_offsets_[group];
+  *last = group_offsets_[group + 1];
+}
+
+const char* ManifestReader::GetSequencePath(const size_t sequence) const {
+  return GetString(sequence_paths_[sequence]);
+}
+
+void ManifestReader::GetSequenceFrames(const size_t sequence, size_t* first,
+                                       size_t* last) const {
+  *first = frame_offsets_[sequence];
+  *last = frame_offsets_[sequence + 1];
+}
+
+const char* ManifestReader::GetFrameName(const size_t frame) const {
+  return GetString(frame_names_[frame]);
+}
+
+void ManifestReader::GetSequenceAnnotations(const size_t sequence, size_t* first,
+                                            size_t* last) const {
+  *first = annotation_offsets_[sequence];
+  *last = annotation_offsets_[sequence + 1];
+}
+
+void ManifestReader::GetAnnotation(const size_t annotation, int* frame_num, BoundingBox* bbox,
+                                   int* display_width, int* display_height) const {
+  *frame_num = annotation_frames_[annotation];
+  *display_width = annotation_sizes_[2 * annotation];
+  *display_height = annotation_sizes_[2 * annotation + 1];
+  const double* box = &annotation_boxes_[4 * annotation];
+  bbox->x1_ = box[0];
+  bbox->y1_ = box[1];
+  bbox->x2_ = box[2];
+  bbox->y2_ = box[3];
+}
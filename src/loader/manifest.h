@@ -0,0 +1,136 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+#include "helper/bounding_box.h"
+
+// Binary dataset manifests.  Parsing the annotations of a dataset at startup
+// (e.g. tens of thousands of XML files for ImageNet DET) can take minutes, so
+// after parsing a dataset the loaders save what they found to a manifest file,
+// which later runs memory-map instead of parsing, as long as the manifest is
+// newer than the dataset's folders.
+//
+// A manifest holds a list of groups (e.g. the ALOV categories), each with a
+// list of sequences (videos, or ImageNet images), each with a path, the names
+// of its frame files, and its annotations (a frame number, a bounding box, and
+// the size of the image that was annotated).  All strings are kept in a string
+// pool and all lists in flat arrays of offsets and values, so that loading a
+// manifest only copies these arrays into the loader.
+
+// Name of the manifest file for the dataset folder: next to the folder, with
+// the extension .manifest.
+std::string ManifestFile(const std::string& folder);
+
+// Latest modification time of the folder and of its subfolders, down to depth
+// levels below it.  Adding or removing files changes the modification time of
+// their folder, but editing a file in place does not, so after editing
+// annotation files the manifest must be deleted to be rebuilt.
+time_t GetNewestFolderTime(const std::string& folder, const int depth);
+
+// Builds a manifest.
+class ManifestWriter
+{
+public:
+  ManifestWriter();
+
+  // Start a new group; the following sequences are added to it.
+  void AddGroup();
+
+  // Start a new sequence with the given path; the following frames and
+  // annotations are added to it.
+  void AddSequence(const std::string& path);
+
+  // Add the name of a frame file to the current sequence.
+  void AddFrame(const std::string& name);
+
+  // Add an annotation to the current sequence.
+  void AddAnnotation(const int frame_num, const BoundingBox& bbox,
+                     const int display_width, const int display_height);
+
+  // Write the manifest, recording the sources it was built from (e.g. the
+  // dataset type and folders).  The manifest is written to a temporary file
+  // and then renamed, so that it is never read partially written.  Returns
+  // false on failure.
+  bool Write(const std::string& manifest_file, const std::string& sources) const;
+
+private:
+  // Index of the string in the pool, adding it if needed (frame names, such
+  // as 00000001.jpg, repeat across videos).
+  uint32_t AddString(const std::string& value);
+
+  std::vector<uint64_t> group_offsets_;
+  std::vector<uint32_t> sequence_paths_;
+  std::vector<uint64_t> frame_offsets_;
+  std::vector<uint64_t> annotation_offsets_;
+  std::vector<uint32_t> frame_names_;
+  std::vector<int32_t> annotation_frames_;
+  std::vector<int32_t> annotation_sizes_;
+  std::vector<double> annotation_boxes_;
+
+  std::vector<uint64_t> string_offsets_;
+  std::string string_data_;
+  std::unordered_map<std::string, uint32_t> string_indices_;
+};
+
+// Reads a memory-mapped manifest.
+class ManifestReader
+{
+public:
+  ManifestReader();
+  ~ManifestReader();
+
+  // Map the manifest, if it exists, was written from the given sources and is
+  // newer than newest_source_time.  Returns false otherwise.
+  bool Open(const std::string& manifest_file, const std::string& sources,
+            const time_t newest_source_time);
+
+  size_t get_num_groups() const { return num_groups_; }
+
+  // Get the range [first, last) of the sequences of the group.
+  void GetGroupSequences(const size_t group, size_t* first, size_t* last) const;
+
+  const char* GetSequencePath(const size_t sequence) const;
+
+  // Get the range [first, last) of the frames of the sequence.
+  void GetSequenceFrames(const size_t sequence, size_t* first, size_t* last) const;
+
+  const char* GetFrameName(const size_t frame) const;
+
+  // Get the range [first, last) of the annotations of the sequence.
+  void GetSequenceAnnotations(const size_t sequence, size_t* first, size_t* last) const;
+
+  void GetAnnotation(const size_t annotation, int* frame_num, BoundingBox* bbox,
+                     int* display_width, int* display_height) const;
+
+private:
+  // Unmap the manifest.
+  void Close();
+
+  const char* GetString(const uint32_t index) const;
+
+  // The mapped file.
+  char* data_;
+  size_t size_;
+
+  size_t num_groups_;
+
+  // Arrays within the mapped file (see ManifestWriter).
+  const uint64_t* group_offsets_;
+  const uint32_t* sequence_paths_;
+  const uint64_t* frame_offsets_;
+  const uint64_t* annotation_offsets_;
+  const uint32_t* frame_names_;
+  const int32_t* annotation_frames_;
+  const int32_t* annotation_sizes_;
+  const double* annotation_boxes_;
+  const uint64_t* string_offsets_;
+  const char* string_data_;
+};
+
+#endif // MANIFEST_H
@@ -0,0 +1,239 @@
+#include "shard.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "helper/image_decode.h"
+
+using std::string;
+
+// Alignment of each image within a shard (a page, so that reading an image
+// touches as few pages as possible).
+const uint64_t kShardAlignment = 4096;
+
+// Shards are closed once they grow beyond this size.
+const uint64_t kMaxShardSize = 1ULL << 30;
+
+// JPEG quality for images that are downscaled while packing.
+const int kJpegQuality = 95;
+
+namespace {
+
+string ShardFile(const string& prefix, const uint32_t shard_num) {
+  char suffix[32];
+  sprintf(suffix, "-%05u.shard", shard_num);
+  return prefix + suffix;
+}
+
+// Read the whole file into memory.
+bool ReadFile(const string& file, std::vector<unsigned char>* data) {
+  FILE* fp = fopen(file.c_str(), "rb");
+  if (!fp) {
+    return false;
+  }
+  fseek(fp, 0, SEEK_END);
+  const long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  data->resize(std::max(size, 0L));
+  const bool ok = size > 0 && fread(data->data(), 1, size, fp) == static_cast<size_t>(size);
+  fclose(fp);
+  return ok;
+}
+
+} // namespace
+
+void WriteShardRecord(const ShardRecord& record, FILE* index_file) {
+  fprintf(index_file, "%u %llu %llu\n", record.shard,
+          static_cast<unsigned long long>(record.offset),
+          static_cast<unsigned long long>(record.size));
+}
+
+bool ReadShardRecord(FILE* index_file, ShardRecord* record) {
+  unsigned long long offset;
+  unsigned long long size;
+  if (fscanf(index_file, "%u %llu %llu\n", &record->shard, &offset, &size) != 3) {
+    return false;
+  }
+  record->offset = offset;
+  record->size = size;
+  return true;
+}
+
+string ShardIndexFile(const string& prefix) {
+  return prefix + ".index";
+}
+
+ShardWriter::ShardWriter(const string& prefix, const int max_image_size)
+  : prefix_(prefix),
+    max_image_size_(max_image_size),
+    shard_file_(NULL),
+    shard_num_(0),
+    shard_size_(0),
+    bytes_written_(0),
+    write_failed_(false)
+{
+}
+
+ShardWriter::~ShardWriter() {
+  Close();
+}
+
+bool ShardWriter::OpenShard() {
+  const string& shard_file = ShardFile(prefix_, shard_num_);
+  shard_file_ = fopen(shard_file.c_str(), "wb");
+  if (!shard_file_) {
+    printf("Could not open shard for writing: %s\n", shard_file.c_str());
+    write_failed_ = true;
+    return false;
+  }
+  shard_size_ = 0;
+  return true;
+}
+
+void ShardWriter::Close() {
+  if (shard_file_) {
+    // Buffered writes may only fail when the shard is flushed.
+    if (fclose(shard_file_) != 0 && !write_failed_) {
+      printf("Could not write shard: %s\n", ShardFile(prefix_, shard_num_).c_str());
+      write_failed_ = true;
+    }
+    shard_file_ = NULL;
+    shard_num_++;
+  }
+}
+
+bool ShardWriter::AddImage(const string& image_file, ShardRecord* record, double* scale) {
+  if (write_failed_) {
+    return false;
+  }
+
+  std::vector<unsigned char> data;
+  if (!ReadFile(image_file, &data)) {
+    printf("Could not read image %s\n", image_file.c_str());
+    return false;
+  }
+
+  // Downscale large images, if requested.
+  *scale = 1;
+  if (max_image_size_ > 0) {
+    const cv::Mat image = cv::imdecode(cv::Mat(data), cv::IMREAD_COLOR);
+    if (!image.data) {
+      printf("Could not decode image %s\n", image_file.c_str());
+      return false;
+    }
+    const int image_size = std::max(image.cols, image.rows);
+    if (image_size > max_image_size_) {
+      *scale = static_cast<double>(max_image_size_) / image_size;
+      cv::Mat image_small;
+      cv::resize(image, image_small,
+                 cv::Size(std::round(image.cols * *scale), std::round(image.rows * *scale)),
+                 0, 0, cv::INTER_AREA);
+      std::vector<int> params;
+      params.push_back(cv::IMWRITE_JPEG_QUALITY);
+      params.push_back(kJpegQuality);
+      cv::imencode(".jpg", image_small, data, params);
+    }
+  }
+
+  // Start a new shard if this one is full.
+  if (shard_file_ && shard_size_ > 0 && shard_size_ + data.size() > kMaxShardSize) {
+    Close();
+  }
+  if (!shard_file_ && !OpenShard()) {
+    return false;
+  }
+
+  // Write the image, padded to the alignment.
+  record->shard = shard_num_;
+  record->offset = shard_size_;
+  record->size = data.size();
+  const uint64_t padded_size =
+      (data.size() + kShardAlignment - 1) / kShardAlignment * kShardAlignment;
+  const std::vector<char> padding(padded_size - data.size(), 0);
+  if (fwrite(data.data(), 1, data.size(), shard_file_) != data.size() ||
+      fwrite(padding.data(), 1, padding.size(), shard_file_) != padding.size()) {
+    printf("Could not write shard: %s\n", ShardFile(prefix_, shard_num_).c_str());
+    write_failed_ = true;
+    return false;
+  }
+  shard_size_ += padded_size;
+  bytes_written_ += padded_size;
+
+  return true;
+}
+
+ShardReader::ShardReader() {
+}
+
+ShardReader::~ShardReader() {
+  Close();
+}
+
+bool ShardReader::Open(const string& prefix) {
+  Close();
+
+  for (uint32_t shard_num = 0; ; ++shard_num) {
+    const string& shard_file = ShardFile(prefix, shard_num);
+    const int fd = open(shard_file.c_str(), O_RDONLY);
+    if (fd < 0) {
+      break;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      printf("Could not read shard: %s\n", shard_file.c_str());
+      close(fd);
+      return false;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      printf("Could not map shard: %s\n", shard_file.c_str());
+      return false;
+    }
+
+    // Images are sampled at random, so reading ahead only wastes I/O.
+    madvise(data, st.st_size, MADV_RANDOM);
+
+    data_.push_back(static_cast<char*>(data));
+    sizes_.push_back(st.st_size);
+  }
+
+  if (data_.empty()) {
+    printf("Could not find any shards with prefix %s\n", prefix.c_str());
+    return false;
+  }
+  return true;
+}
+
+void ShardReader::Close() {
+  for (size_t i = 0; i < data_.size(); ++i) {
+    munmap(data_[i], sizes_[i]);
+  }
+  data_.clear();
+  sizes_.clear();
+}
+
+int ShardReader::ReadImage(const ShardRecord& record, const int reduction, cv::Mat* image) const {
+  if (record.size == 0 || record.shard >= data_.size() ||
+      record.offset + record.size > sizes_[record.shard]) {
+    printf("Invalid shard record: %u %llu %llu\n", record.shard,
+           static_cast<unsigned long long>(record.offset),
+           static_cast<unsigned long long>(record.size));
+    *image = cv::Mat();
+    return 1;
+  }
+
+  // Decode directly from the mapped shard.
+  const cv::Mat buffer(1, record.size, CV_8U, data_[record.shard] + record.offset);
+  return DecodeImageReduced(buffer, reduction, image);
+}
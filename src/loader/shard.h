@@ -0,0 +1,104 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+// Packed image shards.  Reading hundreds of thousands of small image files at
+// random is dominated by file opens and small random reads; instead, the
+// encoded images of a dataset are packed into a few large shard files, which
+// are memory-mapped when training, so that sampling an image is a read from the
+// page cache followed by a decode.
+//
+// A packed dataset with prefix P consists of the shards P-00000.shard,
+// P-00001.shard, ..., each holding encoded images (each aligned to a page), and
+// the index P.index, a text file written by the loader, with the annotations
+// and the ShardRecord of each image.
+
+// Location of an encoded image within the shards.
+struct ShardRecord {
+  uint32_t shard;
+  uint64_t offset;
+  uint64_t size;
+};
+
+// Write a record to (or read it from) a line of an index file.
+void WriteShardRecord(const ShardRecord& record, FILE* index_file);
+bool ReadShardRecord(FILE* index_file, ShardRecord* record);
+
+// Name of the index file for the given prefix.
+std::string ShardIndexFile(const std::string& prefix);
+
+// Packs images into shards.
+class ShardWriter
+{
+public:
+  // If max_image_size > 0, images whose width or height is larger are
+  // downscaled (and re-encoded) to at most max_image_size pixels; otherwise
+  // the original files are stored unchanged.
+  ShardWriter(const std::string& prefix, const int max_image_size);
+  ~ShardWriter();
+
+  // Add the image file to the shards.  Returns the location of the image and
+  // the factor by which it was scaled (1 if it was not downscaled), which
+  // must be applied to its annotations.  Returns false if the image could not
+  // be read, or could not be written (see get_write_failed).
+  bool AddImage(const std::string& image_file, ShardRecord* record, double* scale);
+
+  // Finish the last shard.
+  void Close();
+
+  // Total number of bytes written.
+  uint64_t get_bytes_written() const { return bytes_written_; }
+
+  // Whether a shard could not be opened or written (e.g. on a full disk), in
+  // which case the shards are incomplete and no more images are added.
+  bool get_write_failed() const { return write_failed_; }
+
+private:
+  // Start a new shard.
+  bool OpenShard();
+
+  std::string prefix_;
+  int max_image_size_;
+
+  // Shard that is being written, and its number and size so far.
+  FILE* shard_file_;
+  uint32_t shard_num_;
+  uint64_t shard_size_;
+
+  uint64_t bytes_written_;
+
+  bool write_failed_;
+};
+
+// Reads images from memory-mapped shards.
+class ShardReader
+{
+public:
+  ShardReader();
+  ~ShardReader();
+
+  // Memory-map all shards with the given prefix.  Returns false if there are
+  // no shards or one could not be mapped.
+  bool Open(const std::string& prefix);
+
+  // Decode the image at the given location, at 1/reduction of its size (see
+  // DecodeImageReduced).  Returns the reduction that was applied.
+  int ReadImage(const ShardRecord& record, const int reduction, cv::Mat* image) const;
+
+private:
+  // Unmap all shards.
+  void Close();
+
+  // Start and size of each mapped shard.
+  std::vector<char*> data_;
+  std::vector<size_t> sizes_;
+};
+
+#endif // SHARD_H
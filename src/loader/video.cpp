@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 
+#include "helper/image_decode.h"
+
 using std::string;
 using std::vector;
 
@@ -21,7 +23,8 @@ void Video::ShowVideo() const {
   for (size_t image_frame_num = start_frame; image_frame_num <= end_frame; ++image_frame_num) {
     // Load the image.
     const string& image_file = video_path + "/" + image_files[image_frame_num];
-    cv::Mat image = cv::imread(image_file);
+    cv::Mat image;
+    ReadFrame(image_frame_num, 1, &image);
 
     // Get the frame number for the next annotation.
     const int annotated_frame_num = annotations[annotated_frame_index].frame_num;
@@ -61,6 +64,14 @@ void Video::LoadAnnotation(const int annotation_index,
                           int* frame_num,
                           cv::Mat* image,
                           BoundingBox* box) const {
+  LoadAnnotation(annotation_index, 1, frame_num, image, box);
+}
+
+int Video::LoadAnnotation(const int annotation_index,
+                          const int reduction,
+                          int* frame_num,
+                          cv::Mat* image,
+                          BoundingBox* box) const {
   // Get the annotation corresponding to this index.
   const Frame& annotated_frame = annotations[annotation_index];
 
@@ -74,19 +85,39 @@ void Video::LoadAnnotation(const int annotation_index,
 
   if (image_files.empty()) {
     printf("Error - no image files for video at path: %s\n", path.c_str());
-    return;
+    return 1;
   } else if (*frame_num >= image_files.size()) {
     printf("Cannot find frame: %d; only %zu image files were found at %s\n", *frame_num, image_files.size(), path.c_str());
-    return;
+    return 1;
   }
 
   // Load the image corresponding to this annotation.
   const string& image_file = video_path + "/" + image_files[*frame_num];
-  *image = cv::imread(image_file);
+  const int actual_reduction = ReadFrame(*frame_num, reduction, image);
 
   if (!image->data) {
     printf("Could not find file: %s\n", image_file.c_str());
+    return 1;
+  }
+
+  // Scale the bounding box to the decoded image.
+  if (actual_reduction != 1) {
+    box->x1_ /= actual_reduction;
+    box->x2_ /= actual_reduction;
+    box->y1_ /= actual_reduction;
+    box->y2_ /= actual_reduction;
   }
+
+  return actual_reduction;
+}
+
+int Video::ReadFrame(const int frame_num, const int reduction, cv::Mat* image) const {
+  if (shard_reader) {
+    return shard_reader->ReadImage(frame_records[frame_num], reduction, image);
+  }
+
+  const string& image_file = path + "/" + all_frames[frame_num];
+  return ReadImageReduced(image_file, reduction, image);
 }
 
 bool Video::FindAnnotation(const int frame_num, BoundingBox* box) const {
@@ -108,13 +139,9 @@ bool Video::FindAnnotation(const int frame_num, BoundingBox* box) const {
 bool Video::LoadFrame(const int frame_num, const bool draw_bounding_box,
                      const bool load_only_annotation, cv::Mat* image,
                      BoundingBox* box) const {
-  const string& video_path = path;
-  const vector<string>& image_files = all_frames;
-
   // Load the image for this frame.
   if (!load_only_annotation) {
-    const string& image_file = video_path + "/" + image_files[frame_num];
-    *image = cv::imread(image_file);
+    ReadFrame(frame_num, 1, image);
   }
 
   // Find the annotation (if it exists) for the desired frame_num.
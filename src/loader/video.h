@@ -1,7 +1,10 @@
 #ifndef VIDEO_H
 #define VIDEO_H
 
+#include <boost/shared_ptr.hpp>
+
 #include "helper/bounding_box.h"
+#include "loader/shard.h"
 
 // An image frame and corresponding annotation.
 struct Frame {
@@ -17,6 +20,12 @@ public:
   void LoadAnnotation(const int annotation_index, int* frame_num, cv::Mat* image,
                      BoundingBox* box) const;
 
+  // As above, but with the image decoded at 1/reduction of its size (see
+  // ReadImageReduced) and the bounding box in the coordinates of the decoded image.
+  // Returns the reduction that was applied.
+  int LoadAnnotation(const int annotation_index, const int reduction, int* frame_num,
+                     cv::Mat* image, BoundingBox* box) const;
+
   // Find and return the first frame with an annotation in this video.
   void LoadFirstAnnotation(int* first_frame, cv::Mat* image,
                           BoundingBox* box) const;
@@ -45,7 +54,16 @@ public:
   // if only a strict subset of video frames were labeled.
   std::vector<Frame> annotations;
 
+  // If the frames were packed into shards (see LoaderAlov::SaveShards), the
+  // shards and the location of each frame; otherwise empty.
+  boost::shared_ptr<ShardReader> shard_reader;
+  std::vector<ShardRecord> frame_records;
+
 private:
+  // Read the image for the given frame (from the shards, if it was packed),
+  // at 1/reduction of its size.  Returns the reduction that was applied.
+  int ReadFrame(const int frame_num, const int reduction, cv::Mat* image) const;
+
   // For a given frame num, find an annotation if it exists, and return true.
   // Otherwise return false.
   bool FindAnnotation(const int frame_num, BoundingBox* box) const;
@@ -19,6 +19,82 @@ namespace bfs = boost::filesystem;
 VideoLoader::VideoLoader() {
 }
 
+bool VideoLoader::LoadManifest(const string& manifest_file, const string& sources,
+                               const time_t newest_source_time,
+                               vector<Category>* categories) {
+  ManifestReader manifest;
+  if (!manifest.Open(manifest_file, sources, newest_source_time)) {
+    return false;
+  }
+
+  printf("Loading videos from %s\n", manifest_file.c_str());
+
+  // Each category is a group of the manifest, and each video a sequence.
+  for (size_t i = 0; i < manifest.get_num_groups(); ++i) {
+    Category category;
+    size_t first_video;
+    size_t last_video;
+    manifest.GetGroupSequences(i, &first_video, &last_video);
+    for (size_t j = first_video; j < last_video; ++j) {
+      Video video;
+      video.path = manifest.GetSequencePath(j);
+
+      size_t first_frame;
+      size_t last_frame;
+      manifest.GetSequenceFrames(j, &first_frame, &last_frame);
+      video.all_frames.reserve(last_frame - first_frame);
+      for (size_t k = first_frame; k < last_frame; ++k) {
+        video.all_frames.push_back(manifest.GetFrameName(k));
+      }
+
+      size_t first_annotation;
+      size_t last_annotation;
+      manifest.GetSequenceAnnotations(j, &first_annotation, &last_annotation);
+      video.annotations.resize(last_annotation - first_annotation);
+      for (size_t k = first_annotation; k < last_annotation; ++k) {
+        Frame& frame = video.annotations[k - first_annotation];
+        int display_width;
+        int display_height;
+        manifest.GetAnnotation(k, &frame.frame_num, &frame.bbox, &display_width, &display_height);
+      }
+
+      videos_.push_back(video);
+      if (categories) {
+        category.videos.push_back(video);
+      }
+    }
+    if (categories) {
+      categories->push_back(category);
+    }
+  }
+
+  printf("Found %zu videos\n", videos_.size());
+  return true;
+}
+
+void VideoLoader::SaveManifest(const string& manifest_file, const string& sources,
+                               const vector<Category>& categories) const {
+  ManifestWriter manifest;
+  for (size_t i = 0; i < categories.size(); ++i) {
+    manifest.AddGroup();
+    const vector<Video>& videos = categories[i].videos;
+    for (size_t j = 0; j < videos.size(); ++j) {
+      const Video& video = videos[j];
+      manifest.AddSequence(video.path);
+      for (size_t k = 0; k < video.all_frames.size(); ++k) {
+        manifest.AddFrame(video.all_frames[k]);
+      }
+      for (size_t k = 0; k < video.annotations.size(); ++k) {
+        const Frame& frame = video.annotations[k];
+        manifest.AddAnnotation(frame.frame_num, frame.bbox, 0, 0);
+      }
+    }
+  }
+  if (manifest.Write(manifest_file, sources)) {
+    printf("Saved the videos to %s\n", manifest_file.c_str());
+  }
+}
+
 void VideoLoader::ShowVideos() const {
   // Iterate over all videos.
   printf("Showing %zu videos\n", videos_.size());
@@ -10,6 +10,7 @@
 #include <opencv2/highgui/highgui.hpp>
 
 #include "helper/bounding_box.h"
+#include "loader/manifest.h"
 #include "loader/video.h"
 #include "loader/loader_imagenet_det.h"
 
@@ -29,6 +30,16 @@ public:
   std::vector<Video> get_videos() const { return videos_; }
 
 protected:
+  // Load the videos (into videos_, and into categories if not NULL) from the
+  // manifest, if it is up to date.  Returns false if the videos must be
+  // parsed instead.
+  bool LoadManifest(const std::string& manifest_file, const std::string& sources,
+                    const time_t newest_source_time, std::vector<Category>* categories);
+
+  // Save the videos of the categories to the manifest.
+  void SaveManifest(const std::string& manifest_file, const std::string& sources,
+                    const std::vector<Category>& categories) const;
+
   std::vector<Video> videos_;
 };
 
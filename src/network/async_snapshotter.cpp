@@ -0,0 +1,155 @@
+#include "async_snapshotter.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <caffe/caffe.hpp>
+
+#include "helper/high_res_timer.h"
+#include "network/regressor_train_base.h"
+
+using caffe::Blob;
+
+namespace {
+
+// Copy a blob into a staged blob (reusing its buffer).
+template <typename StagedBlob>
+void StageBlob(const Blob<float>& blob, StagedBlob* staged) {
+  staged->shape = blob.shape();
+  const float* data = blob.cpu_data();
+  staged->data.assign(data, data + blob.count());
+}
+
+// Fill a BlobProto with a staged blob.
+template <typename StagedBlob>
+void StagedBlobToProto(const StagedBlob& staged, caffe::BlobProto* proto) {
+  for (size_t i = 0; i < staged.shape.size(); ++i) {
+    proto->mutable_shape()->add_dim(staged.shape[i]);
+  }
+  proto->mutable_data()->Resize(staged.data.size(), 0);
+  if (!staged.data.empty()) {
+    memcpy(proto->mutable_data()->mutable_data(), &staged.data[0],
+           staged.data.size() * sizeof(float));
+  }
+}
+
+// Name of the snapshot file for the given iteration, as Caffe names it.
+std::string SnapshotFilename(const std::string& prefix, const int iter,
+                             const std::string& extension) {
+  char iter_string[32];
+  snprintf(iter_string, sizeof(iter_string), "%d", iter);
+  return prefix + "_iter_" + iter_string + extension;
+}
+
+} // namespace
+
+AsyncSnapshotter::AsyncSnapshotter(MySolver* solver)
+  : solver_(solver),
+    snapshot_interval_(solver->param().snapshot()),
+    snapshot_prefix_(solver->param().snapshot_prefix()),
+    staged_iter_(0),
+    staged_current_step_(0)
+{
+  solver_->DisableSnapshots();
+}
+
+AsyncSnapshotter::~AsyncSnapshotter() {
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+void AsyncSnapshotter::SnapshotIfDue() {
+  if (snapshot_interval_ > 0 && solver_->iter() % snapshot_interval_ == 0) {
+    Snapshot();
+  }
+}
+
+void AsyncSnapshotter::Snapshot() {
+  HighResTimer hrt("Snapshot stall", CLOCK_MONOTONIC);
+  hrt.start();
+
+  // Wait for the previous snapshot to be written, since its buffers are reused.
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+
+  Stage();
+
+  hrt.stop();
+  printf("[SNAPSHOT] Iteration %d: training stalled for %.1lf ms; writing in the background\n",
+         staged_iter_, hrt.getMilliseconds());
+
+  writer_ = std::thread(&AsyncSnapshotter::Write, this);
+}
+
+void AsyncSnapshotter::Stage() {
+  staged_iter_ = solver_->iter();
+  staged_current_step_ = solver_->get_current_step();
+
+  // Copy the blobs of all layers that have any.
+  const caffe::Net<float>& net = *solver_->net();
+  const std::vector<boost::shared_ptr<caffe::Layer<float> > >& layers = net.layers();
+  size_t num_staged_layers = 0;
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const std::vector<boost::shared_ptr<Blob<float> > >& blobs = layers[i]->blobs();
+    if (blobs.empty()) {
+      continue;
+    }
+    if (staged_layers_.size() <= num_staged_layers) {
+      staged_layers_.resize(num_staged_layers + 1);
+    }
+    StagedLayer& staged_layer = staged_layers_[num_staged_layers++];
+    staged_layer.name = net.layer_names()[i];
+    staged_layer.type = layers[i]->type();
+    staged_layer.blobs.resize(blobs.size());
+    for (size_t j = 0; j < blobs.size(); ++j) {
+      StageBlob(*blobs[j], &staged_layer.blobs[j]);
+    }
+  }
+  staged_layers_.resize(num_staged_layers);
+
+  // Copy the solver history (e.g. the momentum), needed to resume exactly.
+  const std::vector<boost::shared_ptr<Blob<float> > >& history = solver_->history();
+  staged_history_.resize(history.size());
+  for (size_t i = 0; i < history.size(); ++i) {
+    StageBlob(*history[i], &staged_history_[i]);
+  }
+}
+
+void AsyncSnapshotter::Write() {
+  HighResTimer hrt("Snapshot write", CLOCK_MONOTONIC);
+  hrt.start();
+
+  // Write the weights.
+  caffe::NetParameter net_param;
+  net_param.set_name(solver_->net()->name());
+  for (size_t i = 0; i < staged_layers_.size(); ++i) {
+    const StagedLayer& staged_layer = staged_layers_[i];
+    caffe::LayerParameter* layer_param = net_param.add_layer();
+    layer_param->set_name(staged_layer.name);
+    layer_param->set_type(staged_layer.type);
+    for (size_t j = 0; j < staged_layer.blobs.size(); ++j) {
+      StagedBlobToProto(staged_layer.blobs[j], layer_param->add_blobs());
+    }
+  }
+  const std::string model_filename = SnapshotFilename(snapshot_prefix_, staged_iter_,
+                                                      ".caffemodel");
+  caffe::WriteProtoToBinaryFile(net_param, model_filename);
+
+  // Write the solver state, which refers to the weights.
+  caffe::SolverState state;
+  state.set_iter(staged_iter_);
+  state.set_learned_net(model_filename);
+  state.set_current_step(staged_current_step_);
+  for (size_t i = 0; i < staged_history_.size(); ++i) {
+    StagedBlobToProto(staged_history_[i], state.add_history());
+  }
+  const std::string state_filename = SnapshotFilename(snapshot_prefix_, staged_iter_,
+                                                      ".solverstate");
+  caffe::WriteProtoToBinaryFile(state, state_filename);
+
+  hrt.stop();
+  printf("[SNAPSHOT] Iteration %d: wrote %s and %s in %.2lf s\n", staged_iter_,
+         model_filename.c_str(), state_filename.c_str(), hrt.getSeconds());
+}
@@ -0,0 +1,67 @@
+#ifndef ASYNC_SNAPSHOTTER_H
+#define ASYNC_SNAPSHOTTER_H
+
+#include <string>
+#include <thread>
+#include <vector>
+
+class MySolver;
+
+// Writes the solver snapshots (the .caffemodel and the .solverstate, in the
+// same format and with the same names as Caffe) on a background thread.  At
+// each snapshot, the training thread only copies the weights and the solver
+// history into staging buffers, and training continues while they are
+// serialized and written.  The snapshots can be resumed exactly, as with Caffe.
+class AsyncSnapshotter
+{
+public:
+  // Take over the snapshots of the solver, which is then no longer allowed to
+  // write snapshots itself.
+  explicit AsyncSnapshotter(MySolver* solver);
+
+  // Waits for the last snapshot to be written.
+  ~AsyncSnapshotter();
+
+  // Call after each solver step; takes a snapshot if one is due.
+  void SnapshotIfDue();
+
+  // Take a snapshot at the current iteration.
+  void Snapshot();
+
+private:
+  // A copy of a blob.
+  struct StagedBlob {
+    std::vector<int> shape;
+    std::vector<float> data;
+  };
+
+  // A copy of the blobs of a layer.
+  struct StagedLayer {
+    std::string name;
+    std::string type;
+    std::vector<StagedBlob> blobs;
+  };
+
+  // Copy the weights and the solver state into the staging buffers.
+  void Stage();
+
+  // Write the staged snapshot (on the writer thread).
+  void Write();
+
+  MySolver* solver_;
+
+  // Snapshot interval (in iterations) and file prefix, from the solver parameters.
+  int snapshot_interval_;
+  std::string snapshot_prefix_;
+
+  // Staged snapshot.  The buffers are reused for each snapshot.
+  int staged_iter_;
+  int staged_current_step_;
+  std::vector<StagedLayer> staged_layers_;
+  std::vector<StagedBlob> staged_history_;
+
+  // Thread writing the staged snapshot, if any.
+  std::thread writer_;
+};
+
+#endif // ASYNC_SNAPSHOTTER_H
@@ -0,0 +1,31 @@
+#ifndef EXAMPLE_BATCH_H
+#define EXAMPLE_BATCH_H
+
+#include <vector>
+
+#include <stdint.h>
+
+// A batch of training examples, already preprocessed into the layout of the
+// tracker's input blobs, so that the network inputs can point directly at it.
+// The buffers are allocated once for a full batch and reused for later batches
+// (see BatchAssembler); only the first num examples are valid.
+struct ExampleBatch {
+  ExampleBatch() : num(0) {}
+
+  // Number of examples in the batch.
+  int num;
+
+  // Target and image inputs (num x channels x height x width), with the mean
+  // subtracted.
+  std::vector<float> targets;
+  std::vector<float> images;
+
+  // Ground-truth bounding boxes, 4 values per example.
+  std::vector<float> bboxes_gt;
+
+  // Identifies the target of each example: examples with the same target id
+  // have the same target input, so its features only need to be computed once.
+  std::vector<uint64_t> target_ids;
+};
+
+#endif // EXAMPLE_BATCH_H
@@ -0,0 +1,121 @@
+#include "feature_extractor.h"
+
+#include <algorithm>
+
+using caffe::Blob;
+using std::string;
+
+// The backbone has an input for the targets and an input for the images.
+const int kNumInputs = 2;
+
+// Default number of recently processed targets for which to keep the features.
+const size_t kMaxCachedTargets = 16;
+
+FeatureExtractor::FeatureExtractor(const string& backbone_proto,
+                                   const string& caffe_model,
+                                   const int gpu_id)
+  : Regressor(backbone_proto, caffe_model, gpu_id, kNumInputs, false),
+    max_cached_targets_(kMaxCachedTargets)
+{
+}
+
+void FeatureExtractor::set_max_cached_targets(const size_t max_cached_targets) {
+  max_cached_targets_ = max_cached_targets;
+}
+
+const std::vector<float>* FeatureExtractor::FindCachedTarget(const uint64_t target_id) {
+  std::unordered_map<uint64_t, CachedTargetList::iterator>::const_iterator it =
+      target_index_.find(target_id);
+  if (it == target_index_.end()) {
+    return NULL;
+  }
+
+  // Move the target to the front of the list.
+  target_cache_.splice(target_cache_.begin(), target_cache_, it->second);
+  return &it->second->features;
+}
+
+void FeatureExtractor::get_feature_shape(std::vector<int>* shape) const {
+  const boost::shared_ptr<Blob<float> > pool5 = net_->blob_by_name("pool5");
+  shape->clear();
+  shape->push_back(2 * pool5->channels());
+  shape->push_back(pool5->height());
+  shape->push_back(pool5->width());
+}
+
+void FeatureExtractor::Extract(const ExampleBatch& batch, std::vector<float>* features) {
+  const int num = batch.num;
+
+  // Find the distinct targets that are not cached yet.
+  std::vector<int> new_targets;
+  for (int i = 0; i < num; ++i) {
+    const uint64_t target_id = batch.target_ids[i];
+    bool found = FindCachedTarget(target_id) != NULL;
+    for (size_t j = 0; j < new_targets.size() && !found; ++j) {
+      found = batch.target_ids[new_targets[j]] == target_id;
+    }
+    if (!found) {
+      new_targets.push_back(i);
+    }
+  }
+
+  // The two towers are independent, so run the target tower only on the new
+  // targets, and the image tower on all of the images.
+  Blob<float>* input_target = net_->input_blobs()[0];
+  Blob<float>* input_image = net_->input_blobs()[1];
+  std::vector<int> input_shape = input_image->shape();
+  input_shape[0] = std::max<size_t>(new_targets.size(), 1);
+  input_target->Reshape(input_shape);
+  input_shape[0] = num;
+  input_image->Reshape(input_shape);
+  net_->Reshape();
+
+  // The batch is already in the layout of the inputs, so the images are used in
+  // place and the new targets are copied.
+  const int input_size = input_image->count(1);
+  CHECK_LE(input_image->count(), batch.images.size());
+  input_image->data()->set_cpu_data(const_cast<float*>(&batch.images[0]));
+  float* input_target_data = input_target->mutable_cpu_data();
+  for (size_t i = 0; i < new_targets.size(); ++i) {
+    const float* begin = &batch.targets[new_targets[i] * input_size];
+    std::copy(begin, begin + input_size, input_target_data + i * input_size);
+  }
+
+  net_->ForwardPrefilled();
+
+  // Cache the features of the new targets.
+  const boost::shared_ptr<Blob<float> > pool5 = net_->blob_by_name("pool5");
+  const boost::shared_ptr<Blob<float> > pool5_p = net_->blob_by_name("pool5_p");
+  const int target_size = pool5->count(1);
+  const int image_size = pool5_p->count(1);
+  for (size_t i = 0; i < new_targets.size(); ++i) {
+    CachedTarget cached;
+    cached.target_id = batch.target_ids[new_targets[i]];
+    const float* begin = pool5->cpu_data() + i * target_size;
+    cached.features.assign(begin, begin + target_size);
+
+    target_cache_.push_front(cached);
+    target_index_[cached.target_id] = target_cache_.begin();
+  }
+
+  // Evict the least recently used targets, keeping at least those of this batch.
+  const size_t max_cached_targets = std::max(max_cached_targets_, static_cast<size_t>(num));
+  while (target_cache_.size() > max_cached_targets) {
+    target_index_.erase(target_cache_.back().target_id);
+    target_cache_.pop_back();
+  }
+
+  // Concatenate the target and image features of each example, as the concat
+  // layer of the full network does (along the channel axis).
+  features->resize(num * (target_size + image_size));
+  float* output = features->empty() ? NULL : &(*features)[0];
+  for (int i = 0; i < num; ++i) {
+    const std::vector<float>* target_features = FindCachedTarget(batch.target_ids[i]);
+    std::copy(target_features->begin(), target_features->end(), output);
+    output += target_size;
+
+    const float* image_features = pool5_p->cpu_data() + i * image_size;
+    std::copy(image_features, image_features + image_size, output);
+    output += image_size;
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef FEATURE_EXTRACTOR_H
+#define FEATURE_EXTRACTOR_H
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "network/example_batch.h"
+#include "network/regressor.h"
+
+// Computes the pool5 features of targets and search regions with the frozen
+// convolutional towers of the tracker (nets/tracker_backbone.prototxt).
+//
+// Every example generated from a pair of frames shares the same target crop,
+// so the target features are computed once per distinct target; recently seen
+// targets are cached, since a pair's examples may span two batches, and targets
+// that are reused across iterations (see TargetCache) hit the cache again.
+class FeatureExtractor : public Regressor
+{
+public:
+  FeatureExtractor(const std::string& backbone_proto,
+                   const std::string& caffe_model,
+                   const int gpu_id);
+
+  // Compute the concatenated (target, image) pool5 features for each example
+  // of the batch, in the layout of the tracker's pool5_concat blob.
+  void Extract(const ExampleBatch& batch, std::vector<float>* features);
+
+  // Shape of the features of a single example (channels, height, width).
+  void get_feature_shape(std::vector<int>* shape) const;
+
+  // Set the number of targets for which to keep the features.
+  void set_max_cached_targets(const size_t max_cached_targets);
+
+private:
+  // Features of a target that has already been processed.
+  struct CachedTarget {
+    uint64_t target_id;
+    std::vector<float> features;
+  };
+  typedef std::list<CachedTarget> CachedTargetList;
+
+  // Find the features of the given target in the cache (marking them as
+  // recently used), or return NULL.
+  const std::vector<float>* FindCachedTarget(const uint64_t target_id);
+
+  // Processed targets, from most to least recently used, indexed by target id.
+  CachedTargetList target_cache_;
+  std::unordered_map<uint64_t, CachedTargetList::iterator> target_index_;
+  size_t max_cached_targets_;
+};
+
+#endif // FEATURE_EXTRACTOR_H
@@ -0,0 +1,328 @@
+#include "flat_weights.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "helper/high_res_timer.h"
+
+using caffe::Blob;
+using caffe::Layer;
+using caffe::Net;
+using std::string;
+
+// Magic number at the start of every flat weights file.
+const char kFlatWeightsMagic[] = "GOTFLATW";
+const size_t kFlatWeightsMagicSize = 8;
+
+// Version of the file layout.
+const uint64_t kFlatWeightsVersion = 1;
+
+// Alignment of each blob in the file, in bytes (a cache line, and enough for
+// any vectorized access to the weights).
+const uint64_t kFlatWeightsAlignment = 64;
+
+namespace {
+
+uint64_t AlignUp(const uint64_t value) {
+  return (value + kFlatWeightsAlignment - 1) / kFlatWeightsAlignment * kFlatWeightsAlignment;
+}
+
+void WriteUint64(const uint64_t value, FILE* file) {
+  fwrite(&value, sizeof(value), 1, file);
+}
+
+// Sequential reader for the layer table of a mapped file.
+class TableReader {
+public:
+  TableReader(const char* data, const size_t size)
+    : data_(data), size_(size), pos_(0), ok_(true) {}
+
+  uint64_t ReadUint64() {
+    uint64_t value = 0;
+    if (pos_ + sizeof(value) > size_) {
+      ok_ = false;
+      return 0;
+    }
+    memcpy(&value, data_ + pos_, sizeof(value));
+    pos_ += sizeof(value);
+    return value;
+  }
+
+  string ReadString() {
+    const uint64_t length = ReadUint64();
+    if (!ok_ || pos_ + length > size_) {
+      ok_ = false;
+      return string();
+    }
+    const string value(data_ + pos_, length);
+    pos_ += length;
+    return value;
+  }
+
+  // Mark the table as invalid.
+  void set_failed() { ok_ = false; }
+
+  bool ok() const { return ok_; }
+
+private:
+  const char* data_;
+  size_t size_;
+  size_t pos_;
+  bool ok_;
+};
+
+} // namespace
+
+bool WriteFlatWeights(const Net<float>& net, const string& flat_file) {
+  const std::vector<boost::shared_ptr<Layer<float> > >& layers = net.layers();
+  const std::vector<string>& layer_names = net.layer_names();
+
+  // Collect the layers that have weights.
+  std::vector<size_t> layer_ids;
+  for (size_t i = 0; i < layers.size(); ++i) {
+    if (!layers[i]->blobs().empty()) {
+      layer_ids.push_back(i);
+    }
+  }
+
+  // Compute the size of the header and the layer table.
+  uint64_t table_size = kFlatWeightsMagicSize + 2 * sizeof(uint64_t);
+  for (size_t i = 0; i < layer_ids.size(); ++i) {
+    const size_t layer_id = layer_ids[i];
+    table_size += 2 * sizeof(uint64_t) + layer_names[layer_id].size();
+    const std::vector<boost::shared_ptr<Blob<float> > >& blobs = layers[layer_id]->blobs();
+    for (size_t j = 0; j < blobs.size(); ++j) {
+      table_size += (3 + blobs[j]->num_axes()) * sizeof(uint64_t);
+    }
+  }
+
+  FILE* file = fopen(flat_file.c_str(), "wb");
+  if (file == NULL) {
+    printf("Error - could not open %s for writing\n", flat_file.c_str());
+    return false;
+  }
+
+  // Write the header.
+  fwrite(kFlatWeightsMagic, 1, kFlatWeightsMagicSize, file);
+  WriteUint64(kFlatWeightsVersion, file);
+  WriteUint64(layer_ids.size(), file);
+
+  // Write the layer table; blob data starts at the first aligned offset after it.
+  uint64_t offset = AlignUp(table_size);
+  for (size_t i = 0; i < layer_ids.size(); ++i) {
+    const size_t layer_id = layer_ids[i];
+    const string& name = layer_names[layer_id];
+    WriteUint64(name.size(), file);
+    fwrite(name.data(), 1, name.size(), file);
+
+    const std::vector<boost::shared_ptr<Blob<float> > >& blobs = layers[layer_id]->blobs();
+    WriteUint64(blobs.size(), file);
+    for (size_t j = 0; j < blobs.size(); ++j) {
+      const Blob<float>& blob = *blobs[j];
+      WriteUint64(blob.num_axes(), file);
+      for (int k = 0; k < blob.num_axes(); ++k) {
+        WriteUint64(blob.shape(k), file);
+      }
+      WriteUint64(offset, file);
+      WriteUint64(blob.count(), file);
+      offset = AlignUp(offset + blob.count() * sizeof(float));
+    }
+  }
+
+  // Write the blob data, padding each blob to its aligned offset.
+  const std::vector<char> padding(kFlatWeightsAlignment, 0);
+  uint64_t position = table_size;
+  for (size_t i = 0; i < layer_ids.size(); ++i) {
+    const std::vector<boost::shared_ptr<Blob<float> > >& blobs = layers[layer_ids[i]]->blobs();
+    for (size_t j = 0; j < blobs.size(); ++j) {
+      const uint64_t aligned = AlignUp(position);
+      fwrite(&padding[0], 1, aligned - position, file);
+      fwrite(blobs[j]->cpu_data(), sizeof(float), blobs[j]->count(), file);
+      position = aligned + blobs[j]->count() * sizeof(float);
+    }
+  }
+
+  const bool success = !ferror(file);
+  fclose(file);
+  if (!success) {
+    printf("Error - failed to write %s\n", flat_file.c_str());
+  }
+  return success;
+}
+
+bool IsFlatWeightsFile(const string& file) {
+  FILE* f = fopen(file.c_str(), "rb");
+  if (f == NULL) {
+    return false;
+  }
+  char magic[kFlatWeightsMagicSize];
+  const bool is_flat = fread(magic, 1, kFlatWeightsMagicSize, f) == kFlatWeightsMagicSize &&
+      memcmp(magic, kFlatWeightsMagic, kFlatWeightsMagicSize) == 0;
+  fclose(f);
+  return is_flat;
+}
+
+void EvictFromPageCache(const string& file) {
+  const int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  // Dirty pages cannot be dropped, so flush them first.
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+void LoadNetWeights(const string& weights_file, const bool share_memory,
+                    Net<float>* net,
+                    boost::shared_ptr<FlatWeights>* flat_weights) {
+  HighResTimer hrt("Load weights", CLOCK_MONOTONIC);
+  hrt.start();
+
+  if (IsFlatWeightsFile(weights_file)) {
+    flat_weights->reset(new FlatWeights);
+    CHECK((*flat_weights)->Open(weights_file)) << "Could not read flat weights " << weights_file;
+    (*flat_weights)->CopyTo(net, share_memory);
+  } else {
+    flat_weights->reset();
+    net->CopyTrainedLayersFrom(weights_file);
+  }
+
+  hrt.stop();
+  printf("Loaded weights from %s in %lf ms\n", weights_file.c_str(), hrt.getMilliseconds());
+}
+
+FlatWeights::FlatWeights()
+  : data_(NULL),
+    size_(0)
+{
+}
+
+FlatWeights::~FlatWeights() {
+  Close();
+}
+
+void FlatWeights::Close() {
+  if (data_ != NULL) {
+    munmap(data_, size_);
+    data_ = NULL;
+    size_ = 0;
+  }
+  layers_.clear();
+}
+
+bool FlatWeights::Open(const string& flat_file) {
+  Close();
+
+  const int fd = open(flat_file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    printf("Error - could not open %s\n", flat_file.c_str());
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(kFlatWeightsMagicSize)) {
+    close(fd);
+    return false;
+  }
+
+  // Map the file privately and writably: pages are shared with the page cache
+  // until something writes to them (e.g. the weights are updated), at which
+  // point the writer gets its own copy and the file is left untouched.
+  void* data = mmap(NULL, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    printf("Error - could not map %s\n", flat_file.c_str());
+    return false;
+  }
+  data_ = static_cast<char*>(data);
+  size_ = file_stat.st_size;
+
+  if (memcmp(data_, kFlatWeightsMagic, kFlatWeightsMagicSize) != 0) {
+    printf("Error - %s is not a flat weights file\n", flat_file.c_str());
+    Close();
+    return false;
+  }
+
+  // Read the layer table.
+  TableReader reader(data_ + kFlatWeightsMagicSize, size_ - kFlatWeightsMagicSize);
+  const uint64_t version = reader.ReadUint64();
+  if (version != kFlatWeightsVersion) {
+    printf("Error - %s has version %lu, expected %lu\n", flat_file.c_str(),
+           static_cast<unsigned long>(version), static_cast<unsigned long>(kFlatWeightsVersion));
+    Close();
+    return false;
+  }
+
+  const uint64_t num_layers = reader.ReadUint64();
+  for (uint64_t i = 0; i < num_layers && reader.ok(); ++i) {
+    LayerEntry layer;
+    layer.name = reader.ReadString();
+    const uint64_t num_blobs = reader.ReadUint64();
+    for (uint64_t j = 0; j < num_blobs && reader.ok(); ++j) {
+      BlobEntry blob;
+      const uint64_t num_axes = reader.ReadUint64();
+      for (uint64_t k = 0; k < num_axes && reader.ok(); ++k) {
+        blob.shape.push_back(reader.ReadUint64());
+      }
+      blob.offset = reader.ReadUint64();
+      blob.count = reader.ReadUint64();
+
+      // Make sure that the blob data lies within the file.
+      if (blob.offset % kFlatWeightsAlignment != 0 ||
+          blob.offset + blob.count * sizeof(float) > size_) {
+        reader.set_failed();
+        break;
+      }
+      layer.blobs.push_back(blob);
+    }
+    layers_.push_back(layer);
+  }
+
+  if (!reader.ok()) {
+    printf("Error - %s is truncated or corrupt\n", flat_file.c_str());
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void FlatWeights::CopyTo(Net<float>* net, const bool share_memory) const {
+  CHECK(data_ != NULL) << "No flat weights file is open";
+
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    const LayerEntry& layer_entry = layers_[i];
+    if (!net->has_layer(layer_entry.name)) {
+      // Same behavior as CopyTrainedLayersFrom: weights for unknown layers are ignored.
+      LOG(INFO) << "Ignoring source layer " << layer_entry.name;
+      continue;
+    }
+
+    const std::vector<boost::shared_ptr<Blob<float> > >& blobs =
+        net->layer_by_name(layer_entry.name)->blobs();
+    CHECK_EQ(blobs.size(), layer_entry.blobs.size())
+        << "Incompatible number of blobs for layer " << layer_entry.name;
+
+    for (size_t j = 0; j < blobs.size(); ++j) {
+      const BlobEntry& blob_entry = layer_entry.blobs[j];
+      Blob<float>* blob = blobs[j].get();
+      CHECK(blob->shape() == blob_entry.shape)
+          << "Cannot copy flat weights for layer " << layer_entry.name
+          << "; shape mismatch. Source: " << blob_entry.count
+          << " values, target: " << blob->shape_string();
+
+      float* source = reinterpret_cast<float*>(data_ + blob_entry.offset);
+      if (share_memory) {
+        blob->set_cpu_data(source);
+      } else {
+        memcpy(blob->mutable_cpu_data(), source, blob_entry.count * sizeof(float));
+      }
+    }
+  }
+}
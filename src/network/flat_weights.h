@@ -0,0 +1,81 @@
+#ifndef FLAT_WEIGHTS_H
+#define FLAT_WEIGHTS_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <caffe/caffe.hpp>
+
+// A flat, aligned binary format for network weights.  Unlike a .caffemodel,
+// the file can be memory-mapped and its blobs copied (or pointed to) directly,
+// without any protobuf decoding.
+//
+// File layout (all integers are 64-bit, in host byte order):
+//   header:      magic "GOTFLATW", version, number of layers
+//   layer table: for each layer: name length, name, number of blobs;
+//                for each blob: number of axes, axes, data offset, count
+//   blob data:   float values, each blob aligned to 64 bytes
+
+// Write the weights of all layers of the network to a flat weights file.
+// Returns false if the file could not be written.
+bool WriteFlatWeights(const caffe::Net<float>& net, const std::string& flat_file);
+
+// Whether the given file is a flat weights file (checked by its magic number).
+bool IsFlatWeightsFile(const std::string& file);
+
+// Ask the kernel to drop the given file from the page cache, so that the next
+// load measures a cold start.
+void EvictFromPageCache(const std::string& file);
+
+class FlatWeights;
+
+// Load the weights in weights_file (either a .caffemodel or a flat weights
+// file) into the network, and print how long this took.  For a flat weights
+// file, the mapped file is returned in flat_weights; if share_memory is true,
+// the network blobs point into it, so it must be kept alive with the network.
+void LoadNetWeights(const std::string& weights_file, const bool share_memory,
+                    caffe::Net<float>* net,
+                    boost::shared_ptr<FlatWeights>* flat_weights);
+
+// A memory-mapped flat weights file.
+class FlatWeights
+{
+public:
+  FlatWeights();
+  ~FlatWeights();
+
+  // Memory-map the given flat weights file and read its layer table.
+  // Returns false if the file could not be opened or is not a flat weights file.
+  bool Open(const std::string& flat_file);
+
+  // Copy the weights into the layers of the network with matching names.
+  // If share_memory is true, the network blobs point directly into the mapped
+  // file instead (copy-on-write), and this object must outlive the network.
+  void CopyTo(caffe::Net<float>* net, const bool share_memory) const;
+
+private:
+  struct BlobEntry {
+    std::vector<int> shape;
+    uint64_t offset;
+    uint64_t count;
+  };
+
+  struct LayerEntry {
+    std::string name;
+    std::vector<BlobEntry> blobs;
+  };
+
+  // Unmap the file, if it is mapped.
+  void Close();
+
+  // Start and size of the mapped file.
+  char* data_;
+  size_t size_;
+
+  // Layers stored in the file.
+  std::vector<LayerEntry> layers_;
+};
+
+#endif // FLAT_WEIGHTS_H
@@ -0,0 +1,195 @@
+#include "memory_planner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+using caffe::Blob;
+using caffe::Net;
+using caffe::SyncedMemory;
+using std::string;
+
+namespace {
+
+// The storage of one or more blobs (blobs that share data, e.g. the tops of a
+// split or flatten layer, or in-place layers, are planned together).
+struct Storage {
+  SyncedMemory* memory;
+  size_t size;
+
+  // First and last layer that reads or writes this storage.
+  int first_layer;
+  int last_layer;
+
+  // Whether this storage may share a buffer with other storage.
+  bool plannable;
+};
+
+// A shared buffer, and the layer ranges during which it is in use.
+struct Buffer {
+  size_t size;
+  std::vector<std::pair<int, int> > live_ranges;
+};
+
+bool Overlaps(const Buffer& buffer, const int first_layer, const int last_layer) {
+  for (size_t i = 0; i < buffer.live_ranges.size(); ++i) {
+    const std::pair<int, int>& range = buffer.live_ranges[i];
+    if (first_layer <= range.second && range.first <= last_layer) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LargerStorage(const Storage* a, const Storage* b) {
+  return a->size > b->size;
+}
+
+double ToMB(const size_t bytes) {
+  return bytes / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+ActivationMemoryPlanner::ActivationMemoryPlanner()
+  : bytes_before_(0),
+    bytes_after_(0)
+{
+}
+
+void ActivationMemoryPlanner::Plan(Net<float>* net, const std::vector<string>& keep_blobs) {
+  const std::vector<boost::shared_ptr<Blob<float> > >& blobs = net->blobs();
+
+  // Group the blobs by their storage.
+  std::vector<Storage> storages;
+  std::map<SyncedMemory*, int> storage_ids;
+  std::vector<int> blob_storage(blobs.size());
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    SyncedMemory* memory = blobs[i]->data().get();
+    std::map<SyncedMemory*, int>::const_iterator it = storage_ids.find(memory);
+    if (it == storage_ids.end()) {
+      Storage storage;
+      storage.memory = memory;
+      storage.size = memory->size();
+      storage.first_layer = -1;
+      storage.last_layer = -1;
+      storage.plannable = storage.size > 0;
+      storage_ids[memory] = storages.size();
+      blob_storage[i] = storages.size();
+      storages.push_back(storage);
+    } else {
+      blob_storage[i] = it->second;
+    }
+  }
+
+  // Find the range of layers during which each storage is live.
+  for (size_t layer_id = 0; layer_id < net->layers().size(); ++layer_id) {
+    const std::vector<int>& bottom_ids = net->bottom_ids(layer_id);
+    const std::vector<int>& top_ids = net->top_ids(layer_id);
+
+    std::vector<int> used_ids(bottom_ids);
+    used_ids.insert(used_ids.end(), top_ids.begin(), top_ids.end());
+    for (size_t i = 0; i < used_ids.size(); ++i) {
+      Storage& storage = storages[blob_storage[used_ids[i]]];
+      if (storage.first_layer < 0) {
+        storage.first_layer = layer_id;
+      }
+      storage.last_layer = layer_id;
+    }
+
+    // Layers without inputs (e.g. data layers) may fill their outputs outside of
+    // the forward pass, so leave them alone.
+    if (bottom_ids.empty()) {
+      for (size_t i = 0; i < top_ids.size(); ++i) {
+        storages[blob_storage[top_ids[i]]].plannable = false;
+      }
+    }
+  }
+
+  // The inputs are filled before the forward pass, and the outputs and the
+  // requested blobs are read after it.
+  const std::vector<int>& input_ids = net->input_blob_indices();
+  for (size_t i = 0; i < input_ids.size(); ++i) {
+    storages[blob_storage[input_ids[i]]].plannable = false;
+  }
+  const std::vector<int>& output_ids = net->output_blob_indices();
+  for (size_t i = 0; i < output_ids.size(); ++i) {
+    storages[blob_storage[output_ids[i]]].plannable = false;
+  }
+  for (size_t i = 0; i < keep_blobs.size(); ++i) {
+    if (net->has_blob(keep_blobs[i])) {
+      SyncedMemory* memory = net->blob_by_name(keep_blobs[i])->data().get();
+      storages[storage_ids[memory]].plannable = false;
+    }
+  }
+
+  // Assign storage to buffers, largest first.  Each storage goes into the
+  // smallest buffer that is large enough and not in use during its live range;
+  // otherwise it grows the largest free buffer, or gets a new one.
+  std::vector<Storage*> planned;
+  bytes_before_ = 0;
+  bytes_after_ = 0;
+  for (size_t i = 0; i < storages.size(); ++i) {
+    bytes_before_ += storages[i].size;
+    if (storages[i].plannable && storages[i].first_layer >= 0) {
+      planned.push_back(&storages[i]);
+    } else {
+      bytes_after_ += storages[i].size;
+    }
+  }
+  std::stable_sort(planned.begin(), planned.end(), LargerStorage);
+
+  std::vector<Buffer> buffers;
+  std::vector<int> storage_buffer(planned.size());
+  for (size_t i = 0; i < planned.size(); ++i) {
+    const Storage& storage = *planned[i];
+    int best_fit = -1;
+    int largest_free = -1;
+    for (size_t j = 0; j < buffers.size(); ++j) {
+      if (Overlaps(buffers[j], storage.first_layer, storage.last_layer)) {
+        continue;
+      }
+      if (buffers[j].size >= storage.size &&
+          (best_fit < 0 || buffers[j].size < buffers[best_fit].size)) {
+        best_fit = j;
+      }
+      if (largest_free < 0 || buffers[j].size > buffers[largest_free].size) {
+        largest_free = j;
+      }
+    }
+
+    int buffer_id = best_fit >= 0 ? best_fit : largest_free;
+    if (buffer_id < 0) {
+      buffer_id = buffers.size();
+      buffers.push_back(Buffer());
+      buffers.back().size = 0;
+    }
+    Buffer& buffer = buffers[buffer_id];
+    buffer.size = std::max(buffer.size, storage.size);
+    buffer.live_ranges.push_back(std::make_pair(storage.first_layer, storage.last_layer));
+    storage_buffer[i] = buffer_id;
+  }
+
+  // Allocate the buffers and point the planned storage into them.  The storage
+  // that the blobs allocated themselves (if any) is freed.
+  buffers_.clear();
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    buffers_.push_back(boost::shared_ptr<SyncedMemory>(new SyncedMemory(buffers[i].size)));
+    bytes_after_ += buffers[i].size;
+  }
+  for (size_t i = 0; i < planned.size(); ++i) {
+    SyncedMemory* buffer = buffers_[storage_buffer[i]].get();
+    if (caffe::Caffe::mode() == caffe::Caffe::CPU) {
+      planned[i]->memory->set_cpu_data(buffer->mutable_cpu_data());
+    } else {
+#ifndef CPU_ONLY
+      planned[i]->memory->set_gpu_data(buffer->mutable_gpu_data());
+#endif
+    }
+  }
+}
+
+void ActivationMemoryPlanner::PrintReport() const {
+  printf("Activation memory: %.1lf MB before planning, %.1lf MB after (%zu shared buffers)\n",
+         ToMB(bytes_before_), ToMB(bytes_after_), buffers_.size());
+}
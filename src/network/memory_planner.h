@@ -0,0 +1,45 @@
+#ifndef MEMORY_PLANNER_H
+#define MEMORY_PLANNER_H
+
+#include <string>
+#include <vector>
+
+#include <caffe/caffe.hpp>
+
+// Reduces the activation memory of a network that is only used for inference.
+// Caffe gives every top blob its own storage, although most activations are
+// only needed until the next few layers have read them.  The planner computes,
+// for each activation, the range of layers during which it is live, and lets
+// activations whose ranges do not overlap share the same buffer.
+//
+// Diffs are not planned: in TEST mode they are never touched, so Caffe never
+// allocates them.
+//
+// The network's input and output blobs, and any blobs that are read after the
+// forward pass (passed in keep_blobs), keep their own storage.  The plan is
+// valid for the blob shapes at the time that it is made; if a blob later grows,
+// Caffe gives it new (unshared) storage, which is still correct.
+class ActivationMemoryPlanner
+{
+public:
+  ActivationMemoryPlanner();
+
+  // Share activation storage between the blobs of the network.
+  void Plan(caffe::Net<float>* net, const std::vector<std::string>& keep_blobs);
+
+  // Print the activation memory before and after planning.
+  void PrintReport() const;
+
+  // Activation memory before and after planning, in bytes.
+  size_t get_bytes_before() const { return bytes_before_; }
+  size_t get_bytes_after() const { return bytes_after_; }
+
+private:
+  // Shared buffers; the planned blobs point into these.
+  std::vector<boost::shared_ptr<caffe::SyncedMemory> > buffers_;
+
+  size_t bytes_before_;
+  size_t bytes_after_;
+};
+
+#endif // MEMORY_PLANNER_H
@@ -20,8 +20,9 @@ Regressor::Regressor(const string& deploy_proto,
                      const bool do_train)
   : num_inputs_(num_inputs),
     caffe_model_(caffe_model),
-    modified_params_(false)
-
+    modified_params_(false),
+    share_flat_weights_(false),
+    weights_in_flat_file_(false)
 {
   SetupNetwork(deploy_proto, caffe_model, gpu_id, do_train);
 }
@@ -32,7 +33,9 @@ Regressor::Regressor(const string& deploy_proto,
                      const bool do_train)
   : num_inputs_(kNumInputs),
     caffe_model_(caffe_model),
-    modified_params_(false)
+    modified_params_(false),
+    share_flat_weights_(false),
+    weights_in_flat_file_(false)
 {
   SetupNetwork(deploy_proto, caffe_model, gpu_id, do_train);
 }
@@ -59,13 +62,26 @@ void Regressor::SetupNetwork(const string& deploy_proto,
   }
 
   if (caffe_model != "NONE") {
-    net_->CopyTrainedLayersFrom(caffe_model_);
+    // When tracking, the weights are never updated in place, so the network
+    // can use a mapped flat weights file directly instead of copying it.
+    share_flat_weights_ = !do_train;
+    LoadNetWeights(caffe_model_, share_flat_weights_, net_.get(), &flat_weights_);
+    weights_in_flat_file_ = share_flat_weights_ && flat_weights_;
   } else {
     printf("Not initializing network from pre-trained model\n");
   }
 
+  // When tracking, let layers share activation memory, since there is no
+  // backward pass; the estimate (fc8) is read after the forward pass, so it
+  // keeps its own.
+  if (!do_train) {
+    std::vector<string> keep_blobs(1, "fc8");
+    memory_planner_.Plan(net_.get(), keep_blobs);
+    memory_planner_.PrintReport();
+  }
+
   //CHECK_EQ(net_->num_inputs(), num_inputs_) << "Network should have exactly " << num_inputs_ << " inputs.";
-  CHECK_EQ(net_->num_outputs(), 1) << "Network should have exactly one output.";
+  CHECK_GE(net_->num_outputs(), 1) << "Network should have at least one output.";
 
   Blob<float>* input_layer = net_->input_blobs()[0];
 
@@ -85,10 +101,62 @@ void Regressor::SetMean() {
   mean_ = cv::Mat(input_geometry_, CV_32FC3, cv::Scalar(104, 117, 123));
 }
 
+void Regressor::set_modified_params() {
+  // Copy the original weights before they are first modified, so that Init
+  // can restore them quickly, unless they can be restored by mapping the flat
+  // weights file again.  (Copying them up front would fault in every page of
+  // a mapped file, and double the memory used by the weights.)
+  if (!modified_params_ && !weights_in_flat_file_ && param_snapshot_.empty()) {
+    SaveParamSnapshot();
+  }
+  modified_params_ = true;
+}
+
+void Regressor::SaveParamSnapshot() {
+  const std::vector<Blob<float>*>& params = net_->learnable_params();
+  param_snapshot_.resize(params.size());
+  for (size_t i = 0; i < params.size(); ++i) {
+    const float* begin = params[i]->cpu_data();
+    param_snapshot_[i].assign(begin, begin + params[i]->count());
+  }
+}
+
+void Regressor::RestoreParamSnapshot() {
+  const std::vector<Blob<float>*>& params = net_->learnable_params();
+  CHECK_EQ(params.size(), param_snapshot_.size()) << "Parameter snapshot does not match the network.";
+  for (size_t i = 0; i < params.size(); ++i) {
+    // Copy the saved values back into the parameter blob; if the network is on the GPU,
+    // the new values are uploaded the next time that they are used.
+    const std::vector<float>& saved = param_snapshot_[i];
+    std::copy(saved.begin(), saved.end(), params[i]->mutable_cpu_data());
+  }
+}
+
+void Regressor::CopyWeightsFrom(const caffe::NetParameter& weights) {
+  // Flat weights shared with the network are mapped copy-on-write, so they can
+  // be overwritten.
+  net_->CopyTrainedLayersFrom(weights);
+
+  // Init must now restore the new weights, so the snapshot is taken again
+  // when they are first modified.
+  param_snapshot_.clear();
+  weights_in_flat_file_ = false;
+  modified_params_ = false;
+}
+
 void Regressor::Init() {
   if (modified_params_ ) {
-    printf("Reloading new params\n");
-    net_->CopyTrainedLayersFrom(caffe_model_);
+    if (!param_snapshot_.empty()) {
+      printf("Restoring original params\n");
+      RestoreParamSnapshot();
+    } else {
+      // The parameters may point into the current mapping, so it is kept
+      // alive until they have been pointed into (or copied from) the new one.
+      printf("Reloading new params\n");
+      const boost::shared_ptr<FlatWeights> old_flat_weights = flat_weights_;
+      LoadNetWeights(caffe_model_, share_flat_weights_, net_.get(), &flat_weights_);
+      weights_in_flat_file_ = share_flat_weights_ && flat_weights_;
+    }
     modified_params_ = false;
   }
 }
@@ -106,6 +174,16 @@ void Regressor::Regress(const cv::Mat& image_curr,
   *bbox = BoundingBox(estimation);
 }
 
+void Regressor::WarmUp(const int num_iterations) {
+  // The tracker passes one 8-bit crop of the target and one of the search region.
+  const cv::Mat dummy(input_geometry_, num_channels_ == 3 ? CV_8UC3 : CV_8UC1, cv::Scalar::all(0));
+
+  std::vector<float> output;
+  for (int i = 0; i < num_iterations; ++i) {
+    Estimate(dummy, dummy, &output);
+  }
+}
+
 void Regressor::Estimate(const cv::Mat& image, const cv::Mat& target, std::vector<float>* output) {
   assert(net_->phase() == caffe::TEST);
 
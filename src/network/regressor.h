@@ -12,6 +12,8 @@
 #include <vector>
 
 #include "helper/bounding_box.h"
+#include "network/flat_weights.h"
+#include "network/memory_planner.h"
 #include "network/regressor_base.h"
 
 class Regressor : public RegressorBase {
@@ -37,6 +39,14 @@ class Regressor : public RegressorBase {
   // Returns: bbox, an estimated location of the target object in the current image.
   virtual void Regress(const cv::Mat& image_curr, const cv::Mat& image, const cv::Mat& target, BoundingBox* bbox);
 
+  // Copy the weights of the layers in weights into the network (matching the
+  // layers by name), e.g. to track with the weights of a network being trained.
+  void CopyWeightsFrom(const caffe::NetParameter& weights);
+
+  // Run num_iterations forward passes on dummy inputs of the real input size,
+  // so that blob allocation and first-touch page faults happen before tracking starts.
+  void WarmUp(const int num_iterations);
+
 protected:
   // Set the network inputs.
   void SetImages(const std::vector<cv::Mat>& images,
@@ -77,6 +87,11 @@ protected:
   // If the parameters of the network have been modified, reinitialize the parameters to their original values.
   virtual void Init();
 
+  // Mark the network parameters as about to be modified (e.g. by online
+  // adaptation to a target), so that the next call to Init restores their
+  // original values.  Must be called before the parameters are modified.
+  void set_modified_params();
+
  private:
   // Set up a network with the architecture specified in deploy_proto,
   // with the model weights saved in caffe_model.
@@ -88,6 +103,12 @@ protected:
   // Set the mean input (used to normalize the inputs to be 0-mean).
   void SetMean();
 
+  // Save an in-memory copy of the learnable parameters.
+  void SaveParamSnapshot();
+
+  // Restore the learnable parameters from the in-memory copy.
+  void RestoreParamSnapshot();
+
  private:
   // Number of inputs expected by the network.
   int num_inputs_;
@@ -106,6 +127,27 @@ protected:
 
   // Whether the model weights has been modified.
   bool modified_params_;
+
+  // Pristine copy of the learnable parameters (one vector per parameter blob),
+  // used to restore the weights without re-reading caffe_model_ from disk.
+  // Only taken when the parameters are first modified.
+  std::vector<std::vector<float> > param_snapshot_;
+
+  // Whether flat weights are loaded by pointing the network parameters into
+  // the mapped file (when tracking), rather than by copying them.
+  bool share_flat_weights_;
+
+  // Whether the network parameters point into flat_weights_ and still hold
+  // the weights of caffe_model_, so that Init can restore them by mapping the
+  // file again instead of keeping a snapshot.
+  bool weights_in_flat_file_;
+
+  // Mapped weights file, if caffe_model_ is in the flat weights format.
+  // When tracking, the network parameters point into this mapping.
+  boost::shared_ptr<FlatWeights> flat_weights_;
+
+  // Shares activation memory between layers when tracking.
+  ActivationMemoryPlanner memory_planner_;
 };
 
 #endif // REGRESSOR_H
@@ -28,60 +28,48 @@ RegressorTrain::RegressorTrain(const std::string& deploy_proto,
   solver_.set_net(net_);
 }
 
+RegressorTrain::RegressorTrain(const std::string& deploy_proto,
+                               const std::string& caffe_model,
+                               const int gpu_id,
+                               const caffe::SolverParameter& solver_param)
+  : Regressor(deploy_proto, caffe_model, gpu_id, kNumInputs, kDoTrain),
+    RegressorTrainBase(solver_param)
+{
+  solver_.set_net(net_);
+}
+
 void RegressorTrain::set_test_net(const std::string& test_proto) {
   printf("Setting test net to: %s\n", test_proto.c_str());
   test_net_.reset(new caffe::Net<float>(test_proto, caffe::TEST));
   solver_.set_test_net(test_net_);
 }
 
-void RegressorTrain::set_bboxes_gt(const std::vector<BoundingBox>& bboxes_gt) {
-  assert(net_->phase() == caffe::TRAIN);
-
-  // Reshape the bbox.
-  Blob<float>* input_bbox = net_->input_blobs()[2];
-  const size_t num_images = bboxes_gt.size();
-  const int bbox_dims = 4;
-  vector<int> shape;
-  shape.push_back(num_images);
-  shape.push_back(bbox_dims);
-  input_bbox->Reshape(shape);
-
-  // Get a pointer to the bbox memory.
-  float* input_bbox_data = input_bbox->mutable_cpu_data();
+void RegressorTrain::SetInput(const int input_num, const std::vector<int>& shape,
+                              const std::vector<float>& data) {
+  Blob<float>* input = net_->input_blobs()[input_num];
+  input->Reshape(shape);
+  CHECK_LE(input->count(), data.size());
 
-  int input_bbox_data_counter = 0;
-  for (size_t i = 0; i < bboxes_gt.size(); ++i) {
-    const BoundingBox& bbox_gt = bboxes_gt[i];
-
-    // Set the bbox data to the ground-truth bbox.
-    std::vector<float> bbox_vect;
-    bbox_gt.GetVector(&bbox_vect);
-    for (size_t j = 0; j < 4; ++j) {
-      input_bbox_data[input_bbox_data_counter] = bbox_vect[j];
-      input_bbox_data_counter++;
-    }
-  }
+  // The batch is already in the layout of the input, so no copy is needed.
+  input->data()->set_cpu_data(const_cast<float*>(&data[0]));
 }
 
-void RegressorTrain::Train(const std::vector<cv::Mat>& images,
-                           const std::vector<cv::Mat>& targets,
-                           const std::vector<BoundingBox>& bboxes_gt) {
+void RegressorTrain::Train(const ExampleBatch& batch) {
   assert(net_->phase() == caffe::TRAIN);
 
-  if (images.size() != targets.size()) {
-    printf("Error - %zu images but %zu targets\n", images.size(), targets.size());
-  }
-
-  if (images.size() != bboxes_gt.size()) {
-    printf("Error - %zu images but %zu bboxes_gt", images.size(), bboxes_gt.size());
-  }
+  // Set the target and image.
+  const Blob<float>* input_image = net_->input_blobs()[1];
+  vector<int> image_shape = input_image->shape();
+  image_shape[0] = batch.num;
+  SetInput(0, image_shape, batch.targets);
+  SetInput(1, image_shape, batch.images);
 
   // Normally to track we just estimate the bbox location; if we need to backprop,
   // we also need to input the ground-truth bounding boxes.
-  set_bboxes_gt(bboxes_gt);
-
-  // Set the image and target.
-  SetImages(images, targets);
+  vector<int> bbox_shape;
+  bbox_shape.push_back(batch.num);
+  bbox_shape.push_back(4);
+  SetInput(2, bbox_shape, batch.bboxes_gt);
 
   // Train the network.
   Step();
@@ -91,6 +79,6 @@ void RegressorTrain::Step() {
   assert(net_->phase() == caffe::TRAIN);
 
   // Train the network.
-  solver_.Step(1);
+  SolverStep();
 }
 
@@ -18,21 +18,28 @@ public:
                  const int gpu_id,
                  const std::string& solver_file);
 
-  // Train the tracker.
-  void Train(const std::vector<cv::Mat>& images,
-                             const std::vector<cv::Mat>& targets,
-                             const std::vector<BoundingBox>& bboxes_gt);
+  // Train with the given solver parameters (e.g. modified from a solver file).
+  RegressorTrain(const std::string& deploy_proto,
+                 const std::string& caffe_model,
+                 const int gpu_id,
+                 const caffe::SolverParameter& solver_param);
+
+  // Train the tracker.  The network inputs point directly at the batch, so it
+  // must not be modified until the step is done.
+  void Train(const ExampleBatch& batch);
 
   // Set up the solver with the given test file for validation testing.
   void set_test_net(const std::string& test_proto);
 
-private:
+protected:
   // Train the network.
   void Step();
 
-  // Set the ground-truth bounding boxes (for training).
-  void set_bboxes_gt(const std::vector<BoundingBox>& bboxes_gt);
+  // Point the network input at the given data.
+  void SetInput(const int input_num, const std::vector<int>& shape,
+                const std::vector<float>& data);
 
+private:
   boost::shared_ptr<caffe::Net<float> > test_net_;
 };
 
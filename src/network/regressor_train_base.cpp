@@ -1,10 +1,123 @@
 #include "regressor_train_base.h"
 
+namespace {
+
+// Calls a gradient callback of RegressorTrainBase as a Caffe solver callback.
+class SolverCallbackAdapter : public caffe::Solver<float>::Callback
+{
+public:
+  explicit SolverCallbackAdapter(RegressorTrainBase::GradientCallback* callback)
+    : callback_(callback)
+  {
+  }
+
+protected:
+  virtual void on_start() {}
+  virtual void on_gradients_ready() { callback_->OnGradientsReady(); }
+
+private:
+  RegressorTrainBase::GradientCallback* callback_;
+};
+
+} // namespace
+
 MySolver::MySolver(const std::string& param_file)
   : SGDSolver(param_file) {
 }
 
+MySolver::MySolver(const caffe::SolverParameter& param)
+  : SGDSolver(param) {
+}
+
+void MySolver::ApplyAccumulatedUpdate(const float loss) {
+  if (param_.display() && iter_ % param_.display() == 0) {
+    LOG(INFO) << "Iteration " << iter_ << ", loss = " << loss;
+  }
+
+  // The update divides the gradients by iter_size.
+  ApplyUpdate();
+  ++iter_;
+}
+
 RegressorTrainBase::RegressorTrainBase(const std::string& solver_file)
-  : solver_(solver_file)
+  : solver_(solver_file),
+    num_micro_batches_(0),
+    micro_batch_loss_(0)
+{
+  if (solver_.param().snapshot() > 0) {
+    snapshotter_.reset(new AsyncSnapshotter(&solver_));
+  }
+}
+
+RegressorTrainBase::RegressorTrainBase(const caffe::SolverParameter& solver_param)
+  : solver_(solver_param),
+    num_micro_batches_(0),
+    micro_batch_loss_(0)
 {
+  if (solver_.param().snapshot() > 0) {
+    snapshotter_.reset(new AsyncSnapshotter(&solver_));
+  }
+}
+
+void RegressorTrainBase::add_gradient_callback(GradientCallback* callback) {
+  gradient_callbacks_.push_back(callback);
+  solver_callbacks_.push_back(boost::shared_ptr<caffe::Solver<float>::Callback>(
+      new SolverCallbackAdapter(callback)));
+  solver_.add_callback(solver_callbacks_.back().get());
+}
+
+void RegressorTrainBase::SolverStep() {
+  const int iter_size = solver_.param().iter_size();
+  if (iter_size <= 1) {
+    solver_.Step(1);
+  } else {
+    // Add the gradients of this micro-batch to those of the previous ones.
+    const boost::shared_ptr<caffe::Net<float> > net = solver_.net();
+    if (num_micro_batches_ == 0) {
+      net->ClearParamDiffs();
+      micro_batch_loss_ = 0;
+    }
+    micro_batch_loss_ += net->ForwardBackward();
+    num_micro_batches_++;
+    if (num_micro_batches_ < iter_size) {
+      return;
+    }
+    num_micro_batches_ = 0;
+
+    // Update the weights, as Step would after its iter_size passes.
+    for (size_t i = 0; i < gradient_callbacks_.size(); ++i) {
+      gradient_callbacks_[i]->OnGradientsReady();
+    }
+    solver_.ApplyAccumulatedUpdate(micro_batch_loss_ / iter_size);
+  }
+
+  // Caffe would write the snapshot here, stalling the training until it is written.
+  if (snapshotter_) {
+    snapshotter_->SnapshotIfDue();
+  }
+}
+
+void RegressorTrainBase::GetTrainedParams(std::vector<caffe::Blob<float>*>* params) {
+  const boost::shared_ptr<caffe::Net<float> > net = solver_.net();
+  const std::vector<caffe::Blob<float>*>& learnable_params = net->learnable_params();
+  const std::vector<float>& params_lr = net->params_lr();
+  params->clear();
+  for (size_t i = 0; i < learnable_params.size(); ++i) {
+    if (params_lr[i] != 0) {
+      params->push_back(learnable_params[i]);
+    }
+  }
+}
+
+void RegressorTrainBase::GetExampleLosses(std::vector<float>* losses) {
+  // The difference between the predicted and ground-truth bounding boxes, which
+  // the loss layer sums.
+  const boost::shared_ptr<caffe::Blob<float> > diff = solver_.net()->blob_by_name("out_diff");
+  const int num = diff->shape(0);
+  const int dim = diff->count() / num;
+  const float* data = diff->cpu_data();
+  losses->resize(num);
+  for (int i = 0; i < num; ++i) {
+    (*losses)[i] = caffe::caffe_cpu_asum(dim, data + i * dim);
+  }
 }
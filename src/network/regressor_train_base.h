@@ -1,8 +1,10 @@
 #ifndef REGRESSOR_TRAIN_BASE_H
 #define REGRESSOR_TRAIN_BASE_H
 
+#include <algorithm>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -11,6 +13,8 @@
 #include <caffe/sgd_solvers.hpp>
 
 #include "helper/bounding_box.h"
+#include "network/async_snapshotter.h"
+#include "network/example_batch.h"
 #include "network/regressor_base.h"
 
 // We subclass the Caffe solver object so that we can set protected variables like net_ and test_nets_.
@@ -19,28 +23,98 @@ class MySolver : public caffe::SGDSolver<float>
 {
 public:
   MySolver(const std::string& param_file);
+  MySolver(const caffe::SolverParameter& param);
 
   void set_net(const boost::shared_ptr<caffe::Net<float> >& net) {
     net_ = net;
   }
   void set_test_net(const boost::shared_ptr<caffe::Net<float> >& net) {
-    test_nets_[0] = net;
+    // The solver only creates test nets if its parameters specify any.
+    if (test_nets_.empty()) {
+      test_nets_.push_back(net);
+    } else {
+      test_nets_[0] = net;
+    }
   }
+
+  // Stop the solver from writing snapshots itself (see AsyncSnapshotter).
+  void DisableSnapshots() { param_.set_snapshot(0); }
+
+  int get_current_step() const { return current_step_; }
+
+  // Update the weights with the gradients accumulated in the net, as Step does
+  // after its iter_size forward and backward passes (averaging the gradients
+  // over the passes), and display the given mean loss of the passes.
+  void ApplyAccumulatedUpdate(const float loss);
 };
 
 // The class used to train the tracker should inherit from this class.
 class RegressorTrainBase 
 {
 public:
+  // Called at every step, after the gradients have been computed and before
+  // the update is applied.
+  class GradientCallback
+  {
+  public:
+    virtual ~GradientCallback() {}
+    virtual void OnGradientsReady() = 0;
+  };
+
   RegressorTrainBase(const std::string& solver_file);
+  RegressorTrainBase(const caffe::SolverParameter& solver_param);
+
+  // Train the tracker on a preprocessed batch of examples.
+  virtual void Train(const ExampleBatch& batch) = 0;
+
+  // Get a copy of the weights of the network that is being trained.
+  void GetWeights(caffe::NetParameter* weights) { solver_.net()->ToProto(weights, false); }
+
+  // Get the loss of each example of the batch that was most recently trained
+  // on: the sum of the absolute errors of its predicted bounding box (the
+  // per-example terms of the "abssum" loss).
+  void GetExampleLosses(std::vector<float>* losses);
+
+  // Get the parameters that the solver updates (those with a non-zero learning rate).
+  void GetTrainedParams(std::vector<caffe::Blob<float>*>* params);
 
-  // Train the tracker.
-  virtual void Train(const std::vector<cv::Mat>& images,
-             const std::vector<cv::Mat>& targets,
-             const std::vector<BoundingBox>& bboxes_gt) = 0;
+  // Add a callback, called after the gradients of each step have been computed
+  // (over all of its micro-batches) and before the update is applied.
+  void add_gradient_callback(GradientCallback* callback);
+
+  // Get the parameters of the solver (e.g. the display interval).
+  const caffe::SolverParameter& get_solver_param() const { return solver_.param(); }
+
+  // Number of batches (calls to Train) in each solver step: the solver's
+  // iter_size.  Training loops that count batches scale their step counts and
+  // intervals by this.
+  int get_batches_per_step() const { return std::max(1, solver_.param().iter_size()); }
 
 protected:
+  // Take one solver step, and then a snapshot if one is due.
+  //
+  // If the solver's iter_size is more than 1, each call is a micro-batch: its
+  // gradients are added to those of the previous micro-batches, and only every
+  // iter_size-th call updates the weights (with the gradients averaged over the
+  // micro-batches, as Caffe does), so that large batches can be trained with
+  // the memory of a micro-batch.  (Step itself would run its iter_size passes
+  // on the same input, since the inputs are set by the caller.)
+  void SolverStep();
+
   MySolver solver_;
+
+  // Number of micro-batches accumulated since the last update, and their total loss.
+  int num_micro_batches_;
+  float micro_batch_loss_;
+
+  // Not owned.
+  std::vector<GradientCallback*> gradient_callbacks_;
+
+  // Calls the gradient callbacks from within the solver's Step.
+  std::vector<boost::shared_ptr<caffe::Solver<float>::Callback> > solver_callbacks_;
+
+  // Writes the solver snapshots in the background, if the solver parameters ask for snapshots.
+  boost::shared_ptr<AsyncSnapshotter> snapshotter_;
 };
 
 #endif // REGRESSOR_TRAIN_BASE_H
@@ -0,0 +1,104 @@
+#include "regressor_train_distill.h"
+
+using std::string;
+using std::vector;
+using caffe::Blob;
+
+RegressorTrainDistill::RegressorTrainDistill(const string& student_proto,
+                                             const string& caffe_model,
+                                             const string& teacher_proto,
+                                             const string& teacher_model,
+                                             const int gpu_id,
+                                             const string& solver_file)
+  : RegressorTrain(student_proto, caffe_model, gpu_id, solver_file)
+{
+  // The teacher is never updated, so it can use a mapped flat weights file directly.
+  printf("Distilling the teacher %s (%s)\n", teacher_proto.c_str(), teacher_model.c_str());
+  teacher_.reset(new caffe::Net<float>(teacher_proto, caffe::TEST));
+  const bool share_memory = true;
+  LoadNetWeights(teacher_model, share_memory, teacher_.get(), &teacher_weights_);
+
+  const Blob<float>* teacher_input = teacher_->input_blobs()[1];
+  teacher_size_ = cv::Size(teacher_input->width(), teacher_input->height());
+  num_channels_ = teacher_input->channels();
+
+  const Blob<float>* student_input = net_->input_blobs()[1];
+  student_size_ = cv::Size(student_input->width(), student_input->height());
+  CHECK_EQ(student_input->channels(), num_channels_)
+    << "The student and the teacher should have the same number of channels.";
+  CHECK_EQ(net_->num_inputs(), 4) << "The student should have a teacher_bbox input.";
+
+  printf("Student input size: %d x %d, teacher input size: %d x %d\n",
+         student_size_.width, student_size_.height, teacher_size_.width, teacher_size_.height);
+}
+
+void RegressorTrainDistill::EstimateTeacher(const ExampleBatch& batch) {
+  // Point the teacher's inputs at the batch, as for training.
+  vector<int> image_shape;
+  image_shape.push_back(batch.num);
+  image_shape.push_back(num_channels_);
+  image_shape.push_back(teacher_size_.height);
+  image_shape.push_back(teacher_size_.width);
+  const vector<float>* image_inputs[] = { &batch.targets, &batch.images };
+  for (int i = 0; i < 2; ++i) {
+    Blob<float>* input = teacher_->input_blobs()[i];
+    input->Reshape(image_shape);
+    CHECK_LE(input->count(), image_inputs[i]->size())
+      << "The batch should be made at the teacher's input size.";
+    input->data()->set_cpu_data(const_cast<float*>(&(*image_inputs[i])[0]));
+  }
+
+  // The teacher's loss is not used, but it needs the ground-truth input.
+  Blob<float>* input_bbox = teacher_->input_blobs()[2];
+  input_bbox->Reshape(batch.num, 4, 1, 1);
+  input_bbox->data()->set_cpu_data(const_cast<float*>(&batch.bboxes_gt[0]));
+
+  teacher_->Forward();
+
+  const boost::shared_ptr<Blob<float> > estimates = teacher_->blob_by_name("fc8");
+  const float* begin = estimates->cpu_data();
+  teacher_bboxes_.assign(begin, begin + estimates->count());
+}
+
+void RegressorTrainDistill::ResizeInputs(const vector<float>& inputs, const int num,
+                                         vector<float>* resized) const {
+  const int teacher_area = teacher_size_.area();
+  const int student_area = student_size_.area();
+  resized->resize(num * num_channels_ * student_area);
+
+  // The inputs are in planar layout, so each channel of each example is resized
+  // separately; resize writes into the output buffer, since it has the right size.
+  for (int i = 0; i < num * num_channels_; ++i) {
+    const cv::Mat plane(teacher_size_, CV_32FC1, const_cast<float*>(&inputs[i * teacher_area]));
+    cv::Mat resized_plane(student_size_, CV_32FC1, &(*resized)[i * student_area]);
+    cv::resize(plane, resized_plane, student_size_, 0, 0, cv::INTER_AREA);
+  }
+}
+
+void RegressorTrainDistill::Train(const ExampleBatch& batch) {
+  assert(net_->phase() == caffe::TRAIN);
+
+  // Estimate the bounding boxes with the teacher, at full size.
+  EstimateTeacher(batch);
+
+  // Set the target and image, at the student's size.
+  ResizeInputs(batch.targets, batch.num, &targets_);
+  ResizeInputs(batch.images, batch.num, &images_);
+  vector<int> image_shape;
+  image_shape.push_back(batch.num);
+  image_shape.push_back(num_channels_);
+  image_shape.push_back(student_size_.height);
+  image_shape.push_back(student_size_.width);
+  SetInput(0, image_shape, targets_);
+  SetInput(1, image_shape, images_);
+
+  // Set the ground-truth bounding boxes and the teacher's estimates.
+  vector<int> bbox_shape;
+  bbox_shape.push_back(batch.num);
+  bbox_shape.push_back(4);
+  SetInput(2, bbox_shape, batch.bboxes_gt);
+  SetInput(3, bbox_shape, teacher_bboxes_);
+
+  // Train the network.
+  Step();
+}
@@ -0,0 +1,57 @@
+#ifndef REGRESSOR_TRAIN_DISTILL_H
+#define REGRESSOR_TRAIN_DISTILL_H
+
+#include <boost/shared_ptr.hpp>
+
+#include "network/flat_weights.h"
+#include "network/regressor_train.h"
+
+// Train a compact student network (e.g. nets/tracker_student.prototxt) by
+// distillation: a trained teacher tracker (e.g. nets/tracker.prototxt with
+// tracker.caffemodel) estimates the bounding box of each example, and the
+// student learns to regress both the teacher's estimate and the ground truth.
+//
+// The batches are made at the teacher's input size, and shrunk to the
+// student's (smaller) input size.  The student has the same inputs as the
+// tracker, plus a fourth input (teacher_bbox) for the teacher's estimates, so
+// that once trained it can be used for tracking like any other tracker network.
+class RegressorTrainDistill : public RegressorTrain
+{
+public:
+  RegressorTrainDistill(const std::string& student_proto,
+                        const std::string& caffe_model,
+                        const std::string& teacher_proto,
+                        const std::string& teacher_model,
+                        const int gpu_id,
+                        const std::string& solver_file);
+
+  // Train the student on the batch, with the teacher's estimates.
+  void Train(const ExampleBatch& batch);
+
+private:
+  // Estimate the bounding boxes of the batch with the teacher.
+  void EstimateTeacher(const ExampleBatch& batch);
+
+  // Resize the first num inputs (num x channels x teacher size) to the
+  // student's input size.
+  void ResizeInputs(const std::vector<float>& inputs, const int num,
+                    std::vector<float>* resized) const;
+
+  boost::shared_ptr<caffe::Net<float> > teacher_;
+
+  // Mapped teacher weights file, if it is in the flat weights format.
+  boost::shared_ptr<FlatWeights> teacher_weights_;
+
+  // Input sizes of the teacher (the batch size) and of the student.
+  cv::Size teacher_size_;
+  cv::Size student_size_;
+  int num_channels_;
+
+  // The teacher's estimate of each example, and the inputs at the student's
+  // size (reused for each batch).
+  std::vector<float> teacher_bboxes_;
+  std::vector<float> targets_;
+  std::vector<float> images_;
+};
+
+#endif // REGRESSOR_TRAIN_DISTILL_H
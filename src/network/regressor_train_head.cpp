@@ -0,0 +1,64 @@
+#include "regressor_train_head.h"
+
+using caffe::Blob;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Read the solver parameters, and make them train the head network.
+caffe::SolverParameter HeadSolverParameter(const string& solver_file,
+                                           const string& head_proto) {
+  caffe::SolverParameter solver_param;
+  caffe::ReadSolverParamsFromTextFileOrDie(solver_file, &solver_param);
+  solver_param.clear_net_param();
+  solver_param.clear_train_net();
+  solver_param.clear_train_net_param();
+  solver_param.set_net(head_proto);
+  return solver_param;
+}
+
+} // namespace
+
+RegressorTrainHead::RegressorTrainHead(const string& backbone_proto,
+                                       const string& head_proto,
+                                       const string& caffe_model,
+                                       const int gpu_id,
+                                       const string& solver_file)
+  : RegressorTrainBase(HeadSolverParameter(solver_file, head_proto)),
+    feature_extractor_(backbone_proto, caffe_model, gpu_id)
+{
+  // Initialize the head from the same model as the backbone; the layers of the
+  // backbone in caffe_model are ignored.
+  if (caffe_model != "NONE") {
+    solver_.net()->CopyTrainedLayersFrom(caffe_model);
+  }
+}
+
+void RegressorTrainHead::Train(const ExampleBatch& batch) {
+  // Compute the pool5 features of the targets and images.
+  feature_extractor_.Extract(batch, &features_);
+
+  const boost::shared_ptr<caffe::Net<float> > net = solver_.net();
+
+  // Set the features.
+  vector<int> feature_shape;
+  feature_extractor_.get_feature_shape(&feature_shape);
+  feature_shape.insert(feature_shape.begin(), batch.num);
+  Blob<float>* input_features = net->input_blobs()[0];
+  input_features->Reshape(feature_shape);
+  CHECK_EQ(input_features->count(), features_.size());
+  std::copy(features_.begin(), features_.end(), input_features->mutable_cpu_data());
+
+  // Set the ground-truth bounding boxes.
+  Blob<float>* input_bbox = net->input_blobs()[1];
+  vector<int> bbox_shape;
+  bbox_shape.push_back(batch.num);
+  bbox_shape.push_back(4);
+  input_bbox->Reshape(bbox_shape);
+  std::copy(batch.bboxes_gt.begin(), batch.bboxes_gt.begin() + input_bbox->count(),
+            input_bbox->mutable_cpu_data());
+
+  // Train the head.
+  SolverStep();
+}
@@ -0,0 +1,48 @@
+#ifndef REGRESSOR_TRAIN_HEAD_H
+#define REGRESSOR_TRAIN_HEAD_H
+
+#include <string>
+#include <vector>
+
+#include "network/feature_extractor.h"
+#include "network/regressor_train_base.h"
+
+// Trains only the fully connected head of the tracker, on pool5 features
+// computed by a separate inference-only pass through the frozen convolutional
+// towers.  The conv layers of the tracker are not trained (lr_mult: 0), so
+// this learns the same weights, without running the towers in training mode
+// or keeping their activations and diffs for a backward pass.
+//
+// Solver snapshots contain only the head weights; merge them with the
+// backbone weights with the merge_head_weights tool to get a full tracker model.
+class RegressorTrainHead : public RegressorTrainBase
+{
+public:
+  // backbone_proto and head_proto split the tracker network at pool5_concat
+  // (see nets/tracker_backbone.prototxt and nets/tracker_head.prototxt).
+  // Both are initialized from caffe_model; the solver trains head_proto,
+  // regardless of the net specified in solver_file.
+  RegressorTrainHead(const std::string& backbone_proto,
+                     const std::string& head_proto,
+                     const std::string& caffe_model,
+                     const int gpu_id,
+                     const std::string& solver_file);
+
+  // Train the tracker.
+  void Train(const ExampleBatch& batch);
+
+  // Set the number of targets for which to keep the pool5 features
+  // (useful when targets are reused across batches, see TargetCache).
+  void set_max_cached_targets(const size_t max_cached_targets) {
+    feature_extractor_.set_max_cached_targets(max_cached_targets);
+  }
+
+private:
+  // Computes the input features for the head.
+  FeatureExtractor feature_extractor_;
+
+  // Features of the current batch.
+  std::vector<float> features_;
+};
+
+#endif // REGRESSOR_TRAIN_HEAD_H
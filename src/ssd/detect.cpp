@@ -30,11 +30,14 @@
 #include <vector>
 
 #include "helper/helper.h"
+#include "helper/high_res_timer.h"
 
 // GOTURN Tracker
 #include "tracker/tracker.h"
 #include "network/regressor_train.h"
 #include "network/regressor.h"
+#include "network/flat_weights.h"
+#include "network/memory_planner.h"
 #include "loader/loader_alov.h"
 #include "loader/loader_vot.h"
 #include "tracker/tracker.h"
@@ -65,6 +68,21 @@ int standval = 0;
 int walkval = 0;
 DyController controller;
 
+// Measures the time from the start of main until the first command is sent to the robot.
+HighResTimer startup_timer("Time to first command", CLOCK_MONOTONIC);
+bool first_command_sent = false;
+
+// Send a command to the robot, reporting the startup time on the first command.
+int SendCommand(float turn, float speed, int sit, int stand, int walk) {
+  const int result = controller.SendtoController(turn, speed, sit, stand, walk);
+  if (!first_command_sent) {
+    startup_timer.stop();
+    startup_timer.printMilliseconds();
+    first_command_sent = true;
+  }
+  return result;
+}
+
 class Detector {
  public:
   Detector(const string& model_file,
@@ -74,6 +92,10 @@ class Detector {
 
   std::vector<vector<float> > Detect(const cv::Mat& img);
 
+  // Run num_iterations detections on a dummy image of the network input size,
+  // so that blob allocation and first-touch page faults happen before the first frame.
+  void WarmUp(const int num_iterations);
+
  private:
   void SetMean(const string& mean_file, const string& mean_value);
 
@@ -84,6 +106,8 @@ class Detector {
 
  private:
   boost::shared_ptr<Net<float> > net_;
+  boost::shared_ptr<FlatWeights> flat_weights_;
+  ActivationMemoryPlanner memory_planner_;
   cv::Size input_geometry_;
   int num_channels_;
   cv::Mat mean_;
@@ -101,11 +125,15 @@ Detector::Detector(const string& model_file,
 
   /* Load the network. */
   net_.reset(new Net<float>(model_file, TEST));
-  net_->CopyTrainedLayersFrom(weights_file);
+  LoadNetWeights(weights_file, true, net_.get(), &flat_weights_);
 
   CHECK_EQ(net_->num_inputs(), 1) << "Network should have exactly one input.";
   CHECK_EQ(net_->num_outputs(), 1) << "Network should have exactly one output.";
 
+  /* Share activation memory between layers; only the output is read back. */
+  memory_planner_.Plan(net_.get(), std::vector<string>());
+  memory_planner_.PrintReport();
+
   Blob<float>* input_layer = net_->input_blobs()[0];
   num_channels_ = input_layer->channels();
   CHECK(num_channels_ == 3 || num_channels_ == 1)
@@ -148,6 +176,13 @@ std::vector<vector<float> > Detector::Detect(const cv::Mat& img) {
   return detections;
 }
 
+void Detector::WarmUp(const int num_iterations) {
+  const cv::Mat dummy(input_geometry_, num_channels_ == 3 ? CV_8UC3 : CV_8UC1, cv::Scalar::all(0));
+  for (int i = 0; i < num_iterations; ++i) {
+    Detect(dummy);
+  }
+}
+
 /* Load the mean file in binaryproto format. */
 void Detector::SetMean(const string& mean_file, const string& mean_value) {
   cv::Scalar channel_mean;
@@ -369,14 +404,14 @@ void DetectionTrackingProcessFrame(Mat & img, const int frame_count, Detector &d
     if (bbox_area_fraction > STOP_AREA_TH) {
       // do not turn or proceed, send stop command
       int standval_update = 1;
-      int f= controller.SendtoController(turnval, speedval, sitval, standval_update, walkval);
+      int f= SendCommand(turnval, speedval, sitval, standval_update, walkval);
     }
     else {
       // send turn command
       float turnval_update = (bbox_estimate.x1_ + bbox_estimate.x2_)/float(img.cols)/2.0 - 1/2.0;
       turnval_update *= 2;
       int walkval_update = 1;
-      int f= controller.SendtoController(turnval_update, speedval, sitval, standval, walkval_update);
+      int f= SendCommand(turnval_update, speedval, sitval, standval, walkval_update);
     }
   } 
   else if ((*tracker_initialised) && best_person_confidence > PERSON_EXIST_CONFIDENCE_TH) {
@@ -392,14 +427,14 @@ void DetectionTrackingProcessFrame(Mat & img, const int frame_count, Detector &d
     if (bbox_area_fraction > STOP_AREA_TH) {
       // do not turn or proceed, send stop command
       int standval_update = 1;
-      int f= controller.SendtoController(turnval, speedval, sitval, standval_update, walkval);
+      int f= SendCommand(turnval, speedval, sitval, standval_update, walkval);
     }
     else {
       // send turn command
       float turnval_update = (bbox_estimate.x1_ + bbox_estimate.x2_)/float(img.cols)/2.0 - 1/2.0;
       turnval_update *= 6;
       int walkval_update = 1;
-      int f= controller.SendtoController(turnval_update, speedval, sitval, standval, walkval_update);
+      int f= SendCommand(turnval_update, speedval, sitval, standval, walkval_update);
     }
   }
   else {
@@ -407,7 +442,7 @@ void DetectionTrackingProcessFrame(Mat & img, const int frame_count, Detector &d
     // send reset command
     // printf("No people detected!\n");
     int standval_update = 1;
-    int f= controller.SendtoController(turnval, speedval, sitval, standval_update, walkval);
+    int f= SendCommand(turnval, speedval, sitval, standval_update, walkval);
   }
 
   cv::imshow("img to feed to tracker:", img_visualise);
@@ -528,10 +563,14 @@ DEFINE_double(confidence_threshold, 0.01,
     "Only store detections with score higher than the threshold.");
 DEFINE_int32(gpu_id, 0,
     "the gpu to run on");
+DEFINE_int32(warmup_iterations, 1,
+    "Number of dummy forward passes to run through each network before processing frames.");
 
 
 
 int main(int argc, char** argv) {
+  startup_timer.start();
+
   ::google::InitGoogleLogging(argv[0]);
   // Print output to stderr (while still logging)
   FLAGS_alsologtostderr = 1;
@@ -553,8 +592,6 @@ int main(int argc, char** argv) {
   const string& out_file = FLAGS_out_file;
   const float confidence_threshold = FLAGS_confidence_threshold;
 
-  // Initialize the network.
-  Detector detector(model_file, weights_file, mean_file, mean_value);
 
   // Set the output mode.
   std::streambuf* buf = std::cout.rdbuf();
@@ -574,8 +611,50 @@ int main(int argc, char** argv) {
 
   const int gpu_id = FLAGS_gpu_id;
 
-  const bool do_train = false;
-  Regressor regressor(tracker_model_file, tracker_trained_file, gpu_id, do_train);
+  const int warmup_iterations = FLAGS_warmup_iterations;
+
+  // Load and warm up the detector and the tracker networks concurrently.
+  // Caffe's mode and device are per-thread, so each constructor sets them for its own thread.
+  boost::shared_ptr<Detector> detector_ptr;
+  std::thread detector_thread([&]() {
+    HighResTimer hrt("Detector load and warm-up", CLOCK_MONOTONIC);
+    hrt.start();
+    detector_ptr.reset(new Detector(model_file, weights_file, mean_file, mean_value));
+    detector_ptr->WarmUp(warmup_iterations);
+    hrt.stop();
+    hrt.printMilliseconds();
+  });
+
+  boost::shared_ptr<Regressor> regressor_ptr;
+  std::thread regressor_thread([&]() {
+    HighResTimer hrt("Tracker load and warm-up", CLOCK_MONOTONIC);
+    hrt.start();
+    const bool do_train = false;
+    regressor_ptr.reset(new Regressor(tracker_model_file, tracker_trained_file, gpu_id, do_train));
+    regressor_ptr->WarmUp(warmup_iterations);
+    hrt.stop();
+    hrt.printMilliseconds();
+  });
+
+  detector_thread.join();
+  regressor_thread.join();
+
+  Detector& detector = *detector_ptr;
+  Regressor& regressor = *regressor_ptr;
+
+  // Both networks run on this thread from now on, so set up Caffe here too.
+#ifdef CPU_ONLY
+  Caffe::set_mode(Caffe::CPU);
+#else
+  Caffe::SetDevice(gpu_id);
+  Caffe::set_mode(Caffe::GPU);
+#endif
+
+  // Report how long it took for both networks to be ready.
+  HighResTimer ready_timer = startup_timer;
+  ready_timer.reset("Networks ready");
+  ready_timer.stop();
+  ready_timer.printMilliseconds();
 
   // Ensuring randomness for fairness.
   // srandom(800);
@@ -0,0 +1,136 @@
+// Convert a .caffemodel into the flat weights format, which can be memory-mapped
+// at startup instead of being parsed, and compare the load times of both formats.
+//
+// Usage: convert_weights deploy.prototxt network.caffemodel network.flatmodel
+//
+// The resulting file can be passed anywhere that a .caffemodel is accepted
+// (ssd_detect, test_tracker_alov, ...); the format is detected automatically.
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <caffe/caffe.hpp>
+
+#include "helper/high_res_timer.h"
+#include "network/flat_weights.h"
+
+using caffe::Net;
+using std::string;
+
+namespace {
+
+// Number of times to repeat each timing measurement.
+const int kNumRuns = 3;
+
+// Load the weights into a fresh network kNumRuns times and return the mean time
+// in milliseconds.  If cold is true, the file is evicted from the page cache
+// before each run, so that the time includes reading it from disk.
+double TimeLoad(const string& deploy_proto, const string& weights_file,
+                const bool cold, const bool share_memory) {
+  double total_ms = 0;
+  for (int i = 0; i < kNumRuns; ++i) {
+    if (cold) {
+      EvictFromPageCache(weights_file);
+    }
+
+    // The flat weights must outlive the network if it shares their memory.
+    FlatWeights flat_weights;
+    Net<float> net(deploy_proto, caffe::TEST);
+
+    HighResTimer hrt("Load", CLOCK_MONOTONIC);
+    hrt.start();
+    if (IsFlatWeightsFile(weights_file)) {
+      CHECK(flat_weights.Open(weights_file)) << "Could not read " << weights_file;
+      flat_weights.CopyTo(&net, share_memory);
+
+      if (share_memory) {
+        // Read one value per page so that the time includes faulting in the
+        // weights, which a copy or a parse pays for up front.
+        volatile float sum = 0;
+        const std::vector<caffe::Blob<float>*>& params = net.learnable_params();
+        for (size_t j = 0; j < params.size(); ++j) {
+          const float* data = params[j]->cpu_data();
+          for (int k = 0; k < params[j]->count(); k += 1024) {
+            sum += data[k];
+          }
+        }
+      }
+    } else {
+      net.CopyTrainedLayersFrom(weights_file);
+    }
+    hrt.stop();
+    total_ms += hrt.getMilliseconds();
+  }
+  return total_ms / kNumRuns;
+}
+
+// Check that both networks have identical parameters.
+bool SameParams(const Net<float>& net_a, const Net<float>& net_b) {
+  const std::vector<caffe::Blob<float>*>& params_a = net_a.learnable_params();
+  const std::vector<caffe::Blob<float>*>& params_b = net_b.learnable_params();
+  if (params_a.size() != params_b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < params_a.size(); ++i) {
+    if (params_a[i]->count() != params_b[i]->count() ||
+        memcmp(params_a[i]->cpu_data(), params_b[i]->cpu_data(),
+               params_a[i]->count() * sizeof(float)) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main (int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " deploy.prototxt network.caffemodel network.flatmodel" << std::endl;
+    return 1;
+  }
+
+  ::google::InitGoogleLogging(argv[0]);
+
+  const string deploy_proto = argv[1];
+  const string caffe_model  = argv[2];
+  const string flat_model   = argv[3];
+
+  // Conversion only needs the weights on the CPU.
+  caffe::Caffe::set_mode(caffe::Caffe::CPU);
+
+  Net<float> net(deploy_proto, caffe::TEST);
+  net.CopyTrainedLayersFrom(caffe_model);
+
+  printf("Writing flat weights to %s\n", flat_model.c_str());
+  if (!WriteFlatWeights(net, flat_model)) {
+    return 1;
+  }
+
+  // Make sure that the flat file reproduces the original weights exactly.
+  // (The file is unmapped at the end of this scope, so that it can be evicted
+  // from the page cache below.)
+  {
+    Net<float> net_flat(deploy_proto, caffe::TEST);
+    FlatWeights flat_weights;
+    CHECK(flat_weights.Open(flat_model)) << "Could not read " << flat_model;
+    flat_weights.CopyTo(&net_flat, false);
+    if (!SameParams(net, net_flat)) {
+      printf("Error - flat weights do not match %s\n", caffe_model.c_str());
+      return 1;
+    }
+  }
+
+  // Compare load times.  Cold loads rely on the kernel dropping the files from
+  // the page cache, which it will not do for pages mapped by other processes.
+  printf("Load times (mean of %d runs):\n", kNumRuns);
+  printf("  caffemodel, cold:        %10.1lf ms\n", TimeLoad(deploy_proto, caffe_model, true, false));
+  printf("  caffemodel, warm:        %10.1lf ms\n", TimeLoad(deploy_proto, caffe_model, false, false));
+  printf("  flat (copy), cold:       %10.1lf ms\n", TimeLoad(deploy_proto, flat_model, true, false));
+  printf("  flat (copy), warm:       %10.1lf ms\n", TimeLoad(deploy_proto, flat_model, false, false));
+  printf("  flat (mapped), cold:     %10.1lf ms\n", TimeLoad(deploy_proto, flat_model, true, true));
+  printf("  flat (mapped), warm:     %10.1lf ms\n", TimeLoad(deploy_proto, flat_model, false, true));
+
+  return 0;
+}
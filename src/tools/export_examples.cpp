@@ -0,0 +1,235 @@
+// Generate training examples once, in parallel, and save them to LMDB
+// databases, so that the network can be trained with Caffe's own prefetching
+// Data layers (see nets/tracker_lmdb.prototxt) and the same examples can be
+// reused across training runs.
+//
+// Usage: export_examples imagenet_images imagenet_annotations alov_videos alov_annotations
+//                        lambda_shift lambda_scale min_scale max_scale random_seed
+//                        num_batches output_folder [num_threads]
+//
+// This writes output_folder/target_lmdb, output_folder/image_lmdb, and
+// output_folder/bbox_lmdb, which hold the same examples in the same order.
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <caffe/caffe.hpp>
+#include <caffe/util/db.hpp>
+#include <gflags/gflags.h>
+
+#include "helper/high_res_timer.h"
+#include "loader/loader_alov.h"
+#include "loader/loader_imagenet_det.h"
+#include "loader/shard.h"
+#include "train/batch_assembler.h"
+#include "train/example_generator.h"
+#include "train/example_producer.h"
+#include "train/target_cache.h"
+#include "train/train_sampler.h"
+
+using std::string;
+namespace bfs = boost::filesystem;
+
+// Maximum number of complete batches waiting to be saved, per producer thread.
+const int kQueuedBatchesPerThread = 2;
+
+// Number of examples to write to the databases in each transaction.
+const int kExamplesPerTransaction = 1000;
+
+// Size of the network inputs.
+const int kInputSize = 227;
+
+// Number of values per bounding box.
+const int kBBoxSize = 4;
+
+// The databases that hold the examples, one per network input.
+struct ExampleDatabases {
+  boost::scoped_ptr<caffe::db::DB> targets;
+  boost::scoped_ptr<caffe::db::DB> images;
+  boost::scoped_ptr<caffe::db::DB> bboxes;
+};
+
+void OpenDatabase(const string& path, boost::scoped_ptr<caffe::db::DB>* db) {
+  db->reset(caffe::db::GetDB("lmdb"));
+  (*db)->Open(path, caffe::db::NEW);
+}
+
+// Save the examples of the batch as Datums, with consecutive keys starting at
+// *num_examples, so that the databases are read back in the order written.
+void SaveBatch(const ExampleBatch& batch, const BatchAssembler& batch_assembler,
+               caffe::db::Transaction* target_txn, caffe::db::Transaction* image_txn,
+               caffe::db::Transaction* bbox_txn, int* num_examples) {
+  const cv::Size& input_size = batch_assembler.get_input_size();
+  const size_t slot_size = 3 * input_size.width * input_size.height;
+
+  caffe::Datum datum;
+  string value;
+  for (int i = 0; i < batch.num; ++i) {
+    char key[16];
+    snprintf(key, sizeof(key), "%08d", *num_examples);
+
+    // Images are saved as 8-bit pixels; the Data layers subtract the mean again.
+    datum.set_channels(3);
+    datum.set_height(input_size.height);
+    datum.set_width(input_size.width);
+    datum.clear_float_data();
+
+    batch_assembler.RestoreBytes(&batch.targets[i * slot_size], datum.mutable_data());
+    datum.SerializeToString(&value);
+    target_txn->Put(key, value);
+
+    batch_assembler.RestoreBytes(&batch.images[i * slot_size], datum.mutable_data());
+    datum.SerializeToString(&value);
+    image_txn->Put(key, value);
+
+    // Bounding boxes are saved as floats.
+    datum.set_channels(kBBoxSize);
+    datum.set_height(1);
+    datum.set_width(1);
+    datum.set_data("");
+    for (int j = 0; j < kBBoxSize; ++j) {
+      datum.add_float_data(batch.bboxes_gt[i * kBBoxSize + j]);
+    }
+    datum.SerializeToString(&value);
+    bbox_txn->Put(key, value);
+
+    (*num_examples)++;
+  }
+}
+
+int main (int argc, char *argv[]) {
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = ::google;
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc < 12) {
+    std::cerr << "Usage: " << argv[0]
+              << " imagenet_images imagenet_annotations alov_videos alov_annotations"
+              << " lambda_shift lambda_scale min_scale max_scale random_seed"
+              << " num_batches output_folder [num_threads]" << std::endl;
+    std::cerr << "Saves num_batches batches of training examples, generated as train"
+              << " does, to LMDB databases in output_folder.  The images folders may also"
+              << " be shard prefixes written by pack_shards." << std::endl;
+    return 1;
+  }
+
+  FLAGS_alsologtostderr = 1;
+  ::google::InitGoogleLogging(argv[0]);
+
+  int arg_index = 1;
+  const string& imagenet_images      = argv[arg_index++];
+  const string& imagenet_annotations = argv[arg_index++];
+  const string& alov_videos          = argv[arg_index++];
+  const string& alov_annotations     = argv[arg_index++];
+  const double lambda_shift = atof(argv[arg_index++]);
+  const double lambda_scale = atof(argv[arg_index++]);
+  const double min_scale    = atof(argv[arg_index++]);
+  const double max_scale    = atof(argv[arg_index++]);
+  const int random_seed     = atoi(argv[arg_index++]);
+  const int num_batches     = atoi(argv[arg_index++]);
+  const string& output_folder = argv[arg_index++];
+  const int num_threads = argc > arg_index ? atoi(argv[arg_index++]) :
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
+  // Load the image data.
+  boost::shared_ptr<LoaderImagenetDet> image_loader;
+  if (bfs::is_regular_file(ShardIndexFile(imagenet_images))) {
+    image_loader.reset(new LoaderImagenetDet(imagenet_images));
+  } else {
+    image_loader.reset(new LoaderImagenetDet(imagenet_images, imagenet_annotations));
+  }
+  const std::vector<std::vector<Annotation> >& train_images = image_loader->get_images();
+  printf("Total training images: %zu\n", train_images.size());
+
+  // Load the video data.
+  boost::shared_ptr<LoaderAlov> video_loader;
+  if (bfs::is_regular_file(ShardIndexFile(alov_videos))) {
+    video_loader.reset(new LoaderAlov(alov_videos));
+  } else {
+    video_loader.reset(new LoaderAlov(alov_videos, alov_annotations));
+  }
+  std::vector<Video> train_videos;
+  video_loader->get_videos(true, &train_videos);
+  printf("Total training videos: %zu\n", train_videos.size());
+
+  // Sample examples exactly as train does.
+  ExampleGenerator example_generator(lambda_shift, lambda_scale, min_scale, max_scale);
+  TargetCache target_cache(FLAGS_target_cache_size, cv::Size(kInputSize, kInputSize));
+  const double min_crop_size = kInputSize / std::max(1 + min_scale, 0.1);
+  // There are no losses offline, so the annotations are sampled uniformly.
+  ExampleProducer::SampleFunction sample = [&](Rng* rng, TrackerTrainer* tracker_trainer) {
+    train_image(*image_loader, train_images, min_crop_size, &target_cache, NULL, rng,
+                tracker_trainer);
+    train_video(train_videos, min_crop_size, &target_cache, NULL, rng, tracker_trainer);
+  };
+
+  // Create the databases.
+  bfs::create_directories(output_folder);
+  ExampleDatabases databases;
+  OpenDatabase(output_folder + "/target_lmdb", &databases.targets);
+  OpenDatabase(output_folder + "/image_lmdb", &databases.images);
+  OpenDatabase(output_folder + "/bbox_lmdb", &databases.bboxes);
+  boost::scoped_ptr<caffe::db::Transaction> target_txn(databases.targets->NewTransaction());
+  boost::scoped_ptr<caffe::db::Transaction> image_txn(databases.images->NewTransaction());
+  boost::scoped_ptr<caffe::db::Transaction> bbox_txn(databases.bboxes->NewTransaction());
+
+  // Generate the batches on num_threads threads, taking them from the producers
+  // in turn (so the output depends only on the seed and the number of threads).
+  printf("Generating %d batches on %d threads\n", num_batches, num_threads);
+  std::vector<boost::shared_ptr<ExampleProducer> > producers;
+  for (int i = 0; i < num_threads; ++i) {
+    producers.push_back(boost::shared_ptr<ExampleProducer>(
+        new ExampleProducer(example_generator, sample, random_seed, i,
+                            kQueuedBatchesPerThread)));
+    producers.back()->Start();
+  }
+
+  HighResTimer hrt("Export", CLOCK_MONOTONIC);
+  hrt.start();
+
+  const BatchAssembler batch_assembler(1, cv::Size(kInputSize, kInputSize));
+  ExampleBatch batch;
+  int num_examples = 0;
+  int num_uncommitted = 0;
+  for (int batch_num = 0; batch_num < num_batches; ++batch_num) {
+    producers[batch_num % num_threads]->Pop(&batch);
+    SaveBatch(batch, batch_assembler, target_txn.get(), image_txn.get(), bbox_txn.get(),
+              &num_examples);
+    num_uncommitted += batch.num;
+
+    if (num_uncommitted >= kExamplesPerTransaction) {
+      target_txn->Commit();
+      image_txn->Commit();
+      bbox_txn->Commit();
+      target_txn.reset(databases.targets->NewTransaction());
+      image_txn.reset(databases.images->NewTransaction());
+      bbox_txn.reset(databases.bboxes->NewTransaction());
+      num_uncommitted = 0;
+      printf("Saved %d examples\n", num_examples);
+    }
+  }
+
+  // Save the remaining examples.
+  target_txn->Commit();
+  image_txn->Commit();
+  bbox_txn->Commit();
+  databases.targets->Close();
+  databases.images->Close();
+  databases.bboxes->Close();
+
+  // Stop the producers (their destructors wait for them to finish).
+  producers.clear();
+
+  hrt.stop();
+  printf("Saved %d examples to %s\n", num_examples, output_folder.c_str());
+  hrt.printSeconds();
+
+  return 0;
+}
@@ -0,0 +1,43 @@
+// Merge the weights of a tracker head trained on its own (RegressorTrainHead)
+// with the weights of the frozen backbone, into a model for the full tracker.
+//
+// Usage: merge_head_weights tracker.prototxt backbone.caffemodel head.caffemodel output.caffemodel
+
+#include <iostream>
+#include <string>
+
+#include <caffe/caffe.hpp>
+
+using caffe::Net;
+using std::string;
+
+int main (int argc, char *argv[]) {
+  if (argc < 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " tracker.prototxt backbone.caffemodel head.caffemodel output.caffemodel"
+              << std::endl;
+    return 1;
+  }
+
+  ::google::InitGoogleLogging(argv[0]);
+
+  const string full_proto     = argv[1];
+  const string backbone_model = argv[2];
+  const string head_model     = argv[3];
+  const string output_model   = argv[4];
+
+  caffe::Caffe::set_mode(caffe::Caffe::CPU);
+
+  // Layers are matched by name, so load the backbone first and then overwrite
+  // the head layers with their trained values.
+  Net<float> net(full_proto, caffe::TEST);
+  net.CopyTrainedLayersFrom(backbone_model);
+  net.CopyTrainedLayersFrom(head_model);
+
+  caffe::NetParameter net_param;
+  net.ToProto(&net_param, false);
+  caffe::WriteProtoToBinaryFile(net_param, output_model);
+  printf("Saved merged model to %s\n", output_model.c_str());
+
+  return 0;
+}
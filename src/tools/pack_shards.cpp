@@ -0,0 +1,55 @@
+// Pack the ImageNet and ALOV training images, with their annotations, into
+// large shard files, so that training reads them from memory-mapped shards
+// instead of from hundreds of thousands of small files.
+//
+// Usage: pack_shards imagenet_images imagenet_annotations alov_videos alov_annotations
+//                    output_folder [max_image_size]
+//
+// This writes output_folder/imagenet_det.* and output_folder/alov.*; pass the
+// prefixes output_folder/imagenet_det and output_folder/alov to train in place
+// of the image folders.
+
+#include <iostream>
+#include <string>
+
+#include "helper/high_res_timer.h"
+#include "loader/loader_alov.h"
+#include "loader/loader_imagenet_det.h"
+
+using std::string;
+
+int main (int argc, char *argv[]) {
+  if (argc < 6) {
+    std::cerr << "Usage: " << argv[0]
+              << " imagenet_images imagenet_annotations alov_videos alov_annotations"
+              << " output_folder [max_image_size]" << std::endl;
+    std::cerr << "If max_image_size is given, larger images are downscaled to at most"
+              << " max_image_size pixels wide and high." << std::endl;
+    return 1;
+  }
+
+  const string imagenet_images      = argv[1];
+  const string imagenet_annotations = argv[2];
+  const string alov_videos          = argv[3];
+  const string alov_annotations     = argv[4];
+  const string output_folder        = argv[5];
+  const int max_image_size = argc > 6 ? atoi(argv[6]) : 0;
+
+  HighResTimer hrt("Packing", CLOCK_MONOTONIC);
+  hrt.start();
+
+  LoaderImagenetDet image_loader(imagenet_images, imagenet_annotations);
+  if (!image_loader.SaveShards(output_folder + "/imagenet_det", max_image_size)) {
+    return 1;
+  }
+
+  LoaderAlov video_loader(alov_videos, alov_annotations);
+  if (!video_loader.SaveShards(output_folder + "/alov", max_image_size)) {
+    return 1;
+  }
+
+  hrt.stop();
+  hrt.printSeconds();
+
+  return 0;
+}
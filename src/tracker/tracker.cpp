@@ -17,6 +17,7 @@ Tracker::Tracker(const bool show_tracking) :
 void Tracker::Init(const cv::Mat& image, const BoundingBox& bbox_gt,
                    RegressorBase* regressor) {
   image_prev_ = image;
+  pyramid_prev_ = ImagePyramid(image);
   bbox_prev_tight_ = bbox_gt;
 
   // Predict in the current frame that the location will be approximately the same
@@ -44,21 +45,26 @@ void Tracker::Track(const cv::Mat& image_curr, RegressorBase* regressor,
                     BoundingBox* bbox_estimate_uncentered) {
   // Get target from previous image.
   cv::Mat target_pad;
-  CropPadImage(bbox_prev_tight_, image_prev_, &target_pad);
+  CropPadImage(bbox_prev_tight_, pyramid_prev_, &target_pad);
 
   // Crop the current image based on predicted prior location of target.
+  // Large crops are taken from a coarser pyramid level of the current image.
+  ImagePyramid pyramid_curr(image_curr);
   cv::Mat curr_search_region;
   BoundingBox search_location;
-  double edge_spacing_x, edge_spacing_y;
-  CropPadImage(bbox_curr_prior_tight_, image_curr, &curr_search_region, &search_location, &edge_spacing_x, &edge_spacing_y);
+  double edge_spacing_x, edge_spacing_y, search_region_scale;
+  CropPadImage(bbox_curr_prior_tight_, pyramid_curr, &curr_search_region, &search_location,
+               &edge_spacing_x, &edge_spacing_y, &search_region_scale);
 
   // Estimate the bounding box location of the target, centered and scaled relative to the cropped image.
   BoundingBox bbox_estimate;
   regressor->Regress(image_curr, curr_search_region, target_pad, &bbox_estimate);
 
-  // Unscale the estimation to the real image size.
+  // Unscale the estimation to the real image size (the full-resolution size of the search region).
   BoundingBox bbox_estimate_unscaled;
-  bbox_estimate.Unscale(curr_search_region, &bbox_estimate_unscaled);
+  bbox_estimate.Unscale(curr_search_region.cols * search_region_scale,
+                        curr_search_region.rows * search_region_scale,
+                        &bbox_estimate_unscaled);
 
   // Find the estimated bounding box location relative to the current crop.
   bbox_estimate_unscaled.Uncenter(image_curr, search_location, edge_spacing_x, edge_spacing_y, bbox_estimate_uncentered);
@@ -69,6 +75,7 @@ void Tracker::Track(const cv::Mat& image_curr, RegressorBase* regressor,
 
   // Save the image.
   image_prev_ = image_curr;
+  pyramid_prev_ = pyramid_curr;
 
   // Save the current estimate as the location of the target.
   bbox_prev_tight_ = *bbox_estimate_uncentered;
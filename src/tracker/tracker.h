@@ -6,6 +6,7 @@
 #include <opencv2/highgui/highgui.hpp>
 
 #include "helper/bounding_box.h"
+#include "helper/image_pyramid.h"
 #include "train/example_generator.h"
 #include "network/regressor.h"
 
@@ -42,6 +43,10 @@ private:
   // Full previous image.
   cv::Mat image_prev_;
 
+  // Pyramid of the previous image, so that pyramid levels computed while
+  // tracking in one frame are reused to crop the target in the next frame.
+  ImagePyramid pyramid_prev_;
+
   // Whether to visualize the tracking results
   bool show_tracking_;
 };
@@ -7,6 +7,20 @@
 
 using std::string;
 
+// Overlap above which a tracked frame counts as a true positive for the F-score.
+const double kFscoreOverlapThreshold = 0.5;
+
+namespace {
+
+// Overlap (intersection over union) of the estimate with the ground-truth.
+double ComputeIou(const BoundingBox& bbox_gt, const BoundingBox& bbox_estimate) {
+  const double intersection = bbox_gt.compute_intersection(bbox_estimate);
+  const double area_union = bbox_gt.compute_area() + bbox_estimate.compute_area() - intersection;
+  return area_union > 0 ? intersection / area_union : 0;
+}
+
+} // namespace
+
 TrackerManager::TrackerManager(const std::vector<Video>& videos,
                                RegressorBase* regressor, Tracker* tracker) :
   videos_(videos),
@@ -111,6 +125,8 @@ TrackerTesterAlov::TrackerTesterAlov(const std::vector<Video>& videos,
   hrt_("Tracker"),
   total_ms_(0),
   num_frames_(0),
+  total_iou_(0),
+  num_annotated_frames_(0),
   save_videos_(save_videos),
   fps_(30)
 {
@@ -165,6 +181,12 @@ void TrackerTesterAlov::ProcessTrackOutput(
   total_ms_ += ms;
   num_frames_++;
 
+  // Record the accuracy, to compare networks (e.g. a distilled student with its teacher).
+  if (has_annotation) {
+    total_iou_ += ComputeIou(bbox_gt, bbox_estimate);
+    num_annotated_frames_++;
+  }
+
   // Get the tracking output.
   const double width = fabs(bbox_estimate.get_width());
   const double height = fabs(bbox_estimate.get_height());
@@ -202,5 +224,69 @@ void TrackerTesterAlov::PostProcessAll() {
 
   // Compute the mean tracking time per frame.
   const double mean_time_ms = total_ms_ / num_frames_;
-  printf("Mean time: %lf ms\n", mean_time_ms);
+  printf("Mean time: %lf ms (%.1lf fps)\n", mean_time_ms, 1000 / mean_time_ms);
+
+  // Compute the mean overlap with the ground-truth.
+  printf("Mean overlap (IoU) with the ground-truth: %lf over %d annotated frames\n",
+         num_annotated_frames_ > 0 ? total_iou_ / num_annotated_frames_ : 0,
+         num_annotated_frames_);
+}
+
+TrackerEvaluator::TrackerEvaluator(const std::vector<Video>& videos,
+                                   RegressorBase* regressor, Tracker* tracker) :
+  TrackerManager(videos, regressor, tracker),
+  total_iou_(0),
+  num_frames_(0),
+  num_video_frames_(0),
+  num_video_hits_(0),
+  total_fscore_(0),
+  num_videos_(0)
+{
+}
+
+void TrackerEvaluator::VideoInit(const Video& video, const size_t video_num) {
+  num_video_frames_ = 0;
+  num_video_hits_ = 0;
+}
+
+void TrackerEvaluator::ProcessTrackOutput(
+    const size_t frame_num, const cv::Mat& image_curr, const bool has_annotation,
+    const BoundingBox& bbox_gt, const BoundingBox& bbox_estimate,
+    const int pause_val) {
+  if (!has_annotation) {
+    return;
+  }
+
+  const double iou = ComputeIou(bbox_gt, bbox_estimate);
+
+  total_iou_ += iou;
+  num_frames_++;
+
+  num_video_frames_++;
+  if (iou >= kFscoreOverlapThreshold) {
+    num_video_hits_++;
+  }
+}
+
+void TrackerEvaluator::PostProcessVideo() {
+  // The tracker outputs a bounding box in every frame, so each annotated frame
+  // is either a true positive or both a false positive and a false negative.
+  double fscore = 0;
+  if (num_video_hits_ > 0) {
+    const int num_misses = num_video_frames_ - num_video_hits_;
+    const double precision = static_cast<double>(num_video_hits_) / (num_video_hits_ + num_misses);
+    const double recall = static_cast<double>(num_video_hits_) / (num_video_hits_ + num_misses);
+    fscore = 2 * precision * recall / (precision + recall);
+  }
+
+  total_fscore_ += fscore;
+  num_videos_++;
+}
+
+double TrackerEvaluator::get_mean_iou() const {
+  return num_frames_ > 0 ? total_iou_ / num_frames_ : 0;
+}
+
+double TrackerEvaluator::get_mean_fscore() const {
+  return num_videos_ > 0 ? total_fscore_ / num_videos_ : 0;
 }
@@ -110,6 +110,11 @@ private:
   // Number of frames tracked.
   int num_frames_;
 
+  // Sum of the overlaps with the ground-truth over the annotated frames, and
+  // the number of annotated frames.
+  double total_iou_;
+  int num_annotated_frames_;
+
   // Used to save tracking visualization data.
   cv::VideoWriter video_writer_;
 
@@ -119,5 +124,49 @@ private:
   int fps_;
 };
 
+// Track objects and measure the overlap of the tracking output with the
+// ground-truth on every annotated frame, without saving anything (e.g. to
+// validate a network while it is being trained).
+class TrackerEvaluator : public TrackerManager
+{
+public:
+  TrackerEvaluator(const std::vector<Video>& videos,
+                   RegressorBase* regressor, Tracker* tracker);
+
+  // Start counting the frames of a new video.
+  virtual void VideoInit(const Video& video, const size_t video_num);
+
+  // Record the overlap of the estimate with the ground-truth bounding box.
+  virtual void ProcessTrackOutput(
+      const size_t frame_num, const cv::Mat& image_curr, const bool has_annotation,
+      const BoundingBox& bbox_gt, const BoundingBox& bbox_estimate,
+      const int pause_val);
+
+  // Compute the F-score of the video.
+  virtual void PostProcessVideo();
+
+  // Mean overlap (intersection over union) over all annotated frames.
+  double get_mean_iou() const;
+
+  // Mean over all videos of the F-score at an overlap threshold of 0.5,
+  // computed as in scripts/Fscore_v1.0.
+  double get_mean_fscore() const;
+
+  int get_num_frames() const { return num_frames_; }
+
+private:
+  // Sum of the overlaps over all annotated frames, and the number of frames.
+  double total_iou_;
+  int num_frames_;
+
+  // Number of annotated frames of the current video, and the number of them
+  // that were tracked with at least the threshold overlap.
+  int num_video_frames_;
+  int num_video_hits_;
+
+  // Sum of the F-scores of all videos, and the number of videos.
+  double total_fscore_;
+  int num_videos_;
+};
 
 #endif // TRACKER_MANAGER_H
@@ -0,0 +1,102 @@
+#include "background_validator.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include "helper/high_res_timer.h"
+#include "network/regressor.h"
+#include "tracker/tracker.h"
+#include "tracker/tracker_manager.h"
+
+BackgroundValidator::BackgroundValidator(const std::vector<Video>& videos,
+                                         const std::string& deploy_proto,
+                                         const std::string& caffe_model,
+                                         const int gpu_id)
+  : videos_(videos),
+    deploy_proto_(deploy_proto),
+    caffe_model_(caffe_model),
+    gpu_id_(gpu_id),
+    iteration_(0),
+    pending_(false),
+    busy_(false),
+    stop_(false)
+{
+  thread_ = std::thread(&BackgroundValidator::Run, this);
+}
+
+BackgroundValidator::~BackgroundValidator() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  thread_.join();
+}
+
+bool BackgroundValidator::Validate(const int iteration, RegressorTrainBase* regressor_train) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (busy_) {
+      return false;
+    }
+    busy_ = true;
+  }
+
+  // The validation thread is idle, so the weights can be written without the lock.
+  regressor_train->GetWeights(&weights_);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    iteration_ = iteration;
+    pending_ = true;
+  }
+  cond_.notify_all();
+  return true;
+}
+
+void BackgroundValidator::Run() {
+  // The network is created on this thread, since the Caffe mode and device are
+  // set per thread.
+  boost::scoped_ptr<Regressor> regressor;
+  const bool show_intermediate_output = false;
+  Tracker tracker(show_intermediate_output);
+
+  while (true) {
+    int iteration;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this] { return pending_ || stop_; });
+      if (stop_) {
+        return;
+      }
+      pending_ = false;
+      iteration = iteration_;
+    }
+
+    HighResTimer hrt("Validation", CLOCK_MONOTONIC);
+    hrt.start();
+
+    if (!regressor) {
+      const bool do_train = false;
+      regressor.reset(new Regressor(deploy_proto_, caffe_model_, gpu_id_, do_train));
+    }
+    regressor->CopyWeightsFrom(weights_);
+
+    // Track all of the validation videos.
+    TrackerEvaluator evaluator(videos_, regressor.get(), &tracker);
+    evaluator.TrackAll();
+
+    hrt.stop();
+
+    // Log the result with the solver output (e.g. the loss).
+    LOG(INFO) << "Validation at iteration " << iteration << ": mean IoU = "
+              << evaluator.get_mean_iou() << ", mean F-score = "
+              << evaluator.get_mean_fscore() << " (" << videos_.size() << " videos, "
+              << evaluator.get_num_frames() << " annotated frames, "
+              << hrt.getSeconds() << " s)";
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_ = false;
+    }
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef BACKGROUND_VALIDATOR_H
+#define BACKGROUND_VALIDATOR_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <caffe/caffe.hpp>
+
+#include "loader/video.h"
+#include "network/regressor_train_base.h"
+
+// Validates the network while it is being trained, by tracking a fixed set of
+// validation videos on a background thread and logging the mean overlap (IoU)
+// and F-score.  Each validation tracks with a TEST-phase copy of the weights
+// at the time that it was started, so training continues during validation.
+class BackgroundValidator
+{
+public:
+  // Track the given videos with the network in deploy_proto, initialized from
+  // caffe_model (so that layers that are not trained keep their weights).
+  BackgroundValidator(const std::vector<Video>& videos,
+                      const std::string& deploy_proto,
+                      const std::string& caffe_model,
+                      const int gpu_id);
+
+  // Waits for the current validation (if any) to finish.
+  ~BackgroundValidator();
+
+  // Start validating the current weights of regressor_train, labelled with the
+  // given iteration.  Only copying the weights blocks the caller.  If the
+  // previous validation is still running, nothing is done and false is returned.
+  bool Validate(const int iteration, RegressorTrainBase* regressor_train);
+
+private:
+  // Thread body.
+  void Run();
+
+  std::vector<Video> videos_;
+  std::string deploy_proto_;
+  std::string caffe_model_;
+  int gpu_id_;
+
+  // Weights and iteration of the requested validation.
+  caffe::NetParameter weights_;
+  int iteration_;
+
+  // Whether a validation has been requested, whether one is requested or
+  // running, and whether the thread should exit.
+  bool pending_;
+  bool busy_;
+  bool stop_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::thread thread_;
+};
+
+#endif // BACKGROUND_VALIDATOR_H
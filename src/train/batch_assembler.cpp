@@ -0,0 +1,129 @@
+#include "batch_assembler.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+#include <opencv2/imgproc/imgproc.hpp>
+
+// Number of channels of the network inputs.
+const int kNumChannels = 3;
+
+// Mean of each input channel (BGR), as in Regressor::SetMean.
+const double kChannelMean[kNumChannels] = {104, 117, 123};
+
+// Number of values per bounding box.
+const int kBBoxSize = 4;
+
+BatchAssembler::BatchAssembler(const int batch_size, const cv::Size& input_size)
+  : batch_size_(batch_size),
+    input_size_(input_size),
+    slot_size_(kNumChannels * input_size.width * input_size.height)
+{
+}
+
+void BatchAssembler::Reset(ExampleBatch* batch) const {
+  batch->num = 0;
+  batch->targets.resize(batch_size_ * slot_size_);
+  batch->images.resize(batch_size_ * slot_size_);
+  batch->bboxes_gt.resize(batch_size_ * kBBoxSize);
+  batch->target_ids.resize(batch_size_);
+}
+
+cv::Mat BatchAssembler::GetImageSlotBytes(ExampleBatch* batch) const {
+  CHECK_LT(batch->num, batch_size_);
+  return cv::Mat(input_size_, CV_8UC3, GetSlotBytes(&batch->images[batch->num * slot_size_]));
+}
+
+bool BatchAssembler::Add(const cv::Mat& image, const cv::Mat& target, const uint64_t target_id,
+                         const BoundingBox& bbox_gt_scaled, ExampleBatch* batch) const {
+  CHECK_LT(batch->num, batch_size_);
+  const int slot = batch->num;
+
+  // An image written into the slot (see GetImageSlotBytes) only needs to be
+  // converted; it may also have been reallocated (e.g. if it was grayscale).
+  float* image_slot = &batch->images[slot * slot_size_];
+  if (image.data == GetSlotBytes(image_slot) && image.type() == CV_8UC3 &&
+      image.size() == input_size_) {
+    ConvertSlotBytes(image_slot);
+  } else {
+    Preprocess(image, image_slot);
+  }
+  Preprocess(target, &batch->targets[slot * slot_size_]);
+
+  std::vector<float> bbox_vect;
+  bbox_gt_scaled.GetVector(&bbox_vect);
+  std::copy(bbox_vect.begin(), bbox_vect.end(), &batch->bboxes_gt[slot * kBBoxSize]);
+
+  batch->target_ids[slot] = target_id;
+
+  batch->num++;
+  return batch->num == batch_size_;
+}
+
+void BatchAssembler::Preprocess(const cv::Mat& image, float* slot) const {
+  // Convert the image to 3 channels.
+  cv::Mat sample;
+  if (image.channels() == 1) {
+    cv::cvtColor(image, sample, CV_GRAY2BGR);
+  } else if (image.channels() == 4) {
+    cv::cvtColor(image, sample, CV_BGRA2BGR);
+  } else {
+    sample = image;
+  }
+
+  // Resize the image to the network input size.
+  cv::Mat sample_resized;
+  if (sample.size() != input_size_) {
+    cv::resize(sample, sample_resized, input_size_);
+  } else {
+    sample_resized = sample;
+  }
+
+  // Split the image into its channels, and convert each one to float (with the
+  // mean subtracted) directly into its plane of the slot.
+  std::vector<cv::Mat> channels;
+  cv::split(sample_resized, channels);
+  const int plane_size = input_size_.width * input_size_.height;
+  for (int i = 0; i < kNumChannels; ++i) {
+    cv::Mat plane(input_size_, CV_32FC1, slot + i * plane_size);
+    channels[i].convertTo(plane, CV_32F, 1, -kChannelMean[i]);
+  }
+}
+
+uint8_t* BatchAssembler::GetSlotBytes(float* slot) const {
+  // The 8-bit image (a third of the size of the slot) is at the end of the
+  // slot, so that converting it in place only overwrites pixels that have
+  // already been read (see ConvertSlotBytes).
+  return reinterpret_cast<uint8_t*>(slot + slot_size_) - slot_size_;
+}
+
+void BatchAssembler::ConvertSlotBytes(float* slot) const {
+  // Pixel i of the last plane is written over the bytes of pixels up to i,
+  // and the other planes are written before the bytes start, so each pixel is
+  // read before it is overwritten.
+  const uint8_t* bytes = GetSlotBytes(slot);
+  const int plane_size = input_size_.width * input_size_.height;
+  float* plane_0 = slot;
+  float* plane_1 = slot + plane_size;
+  float* plane_2 = slot + 2 * plane_size;
+  for (int i = 0; i < plane_size; ++i) {
+    const float value_0 = bytes[kNumChannels * i];
+    const float value_1 = bytes[kNumChannels * i + 1];
+    const float value_2 = bytes[kNumChannels * i + 2];
+    plane_0[i] = value_0 - kChannelMean[0];
+    plane_1[i] = value_1 - kChannelMean[1];
+    plane_2[i] = value_2 - kChannelMean[2];
+  }
+}
+
+void BatchAssembler::RestoreBytes(const float* slot, std::string* bytes) const {
+  // Add the mean back to each plane (the preprocessed values are the original
+  // 8-bit values minus the mean, so this is exact).
+  bytes->resize(slot_size_);
+  const int plane_size = input_size_.width * input_size_.height;
+  for (int i = 0; i < kNumChannels; ++i) {
+    const cv::Mat plane(input_size_, CV_32FC1, const_cast<float*>(slot + i * plane_size));
+    cv::Mat bytes_plane(input_size_, CV_8UC1, &(*bytes)[i * plane_size]);
+    plane.convertTo(bytes_plane, CV_8U, 1, kChannelMean[i]);
+  }
+}
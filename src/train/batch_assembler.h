@@ -0,0 +1,61 @@
+#ifndef BATCH_ASSEMBLER_H
+#define BATCH_ASSEMBLER_H
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "helper/bounding_box.h"
+#include "network/example_batch.h"
+
+// Preprocesses training examples directly into their slots in an ExampleBatch
+// (resizing them to the network input size, converting them to float, and
+// subtracting the mean as Regressor does), so that no intermediate copies of
+// the batch are made.
+class BatchAssembler
+{
+public:
+  BatchAssembler(const int batch_size, const cv::Size& input_size);
+
+  // Allocate the buffers of the batch (unless they are already allocated) and
+  // mark it as empty.
+  void Reset(ExampleBatch* batch) const;
+
+  // Get an 8-bit, 3-channel image of the input size over the memory of the next
+  // image slot of the batch, so that an example can be written directly into
+  // the batch (e.g. by ExampleGenerator::MakeTrainingExampleWarped) and then
+  // passed to Add, which converts it in place.
+  cv::Mat GetImageSlotBytes(ExampleBatch* batch) const;
+
+  // Add an example to the next slot of the batch.  If image is the image
+  // returned by GetImageSlotBytes, it is converted in place.  Returns true if
+  // the batch is now full.
+  bool Add(const cv::Mat& image, const cv::Mat& target, const uint64_t target_id,
+           const BoundingBox& bbox_gt_scaled, ExampleBatch* batch) const;
+
+  // Undo the preprocessing of a slot of the batch, recovering the 8-bit pixels
+  // of the resized example (channels x height x width, as in a Caffe Datum).
+  void RestoreBytes(const float* slot, std::string* bytes) const;
+
+  int get_batch_size() const { return batch_size_; }
+  const cv::Size& get_input_size() const { return input_size_; }
+
+private:
+  // Preprocess the image into the given slot (channels x height x width).
+  void Preprocess(const cv::Mat& image, float* slot) const;
+
+  // Start of the bytes of the slot that GetImageSlotBytes returns.
+  uint8_t* GetSlotBytes(float* slot) const;
+
+  // Convert the 8-bit image in the bytes of the slot (see GetSlotBytes) into
+  // the preprocessed slot, in place.
+  void ConvertSlotBytes(float* slot) const;
+
+  int batch_size_;
+  cv::Size input_size_;
+
+  // Number of floats in the slot of each image.
+  size_t slot_size_;
+};
+
+#endif // BATCH_ASSEMBLER_H
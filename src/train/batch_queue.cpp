@@ -0,0 +1,57 @@
+#include "batch_queue.h"
+
+BatchQueue::BatchQueue(const size_t max_size)
+  : max_size_(max_size),
+    closed_(false)
+{
+}
+
+bool BatchQueue::Push(ExampleBatch* batch) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!closed_ && batches_.size() >= max_size_) {
+    not_full_.wait(lock);
+  }
+  if (closed_) {
+    return false;
+  }
+
+  batches_.push_back(ExampleBatch());
+  std::swap(batches_.back(), *batch);
+  if (!free_batches_.empty()) {
+    std::swap(free_batches_.back(), *batch);
+    free_batches_.pop_back();
+  }
+  not_empty_.notify_one();
+  return true;
+}
+
+bool BatchQueue::Pop(ExampleBatch* batch) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!closed_ && batches_.empty()) {
+    not_empty_.wait(lock);
+  }
+  if (closed_) {
+    return false;
+  }
+
+  if (!batch->images.empty()) {
+    free_batches_.push_back(ExampleBatch());
+    std::swap(free_batches_.back(), *batch);
+  }
+  std::swap(batches_.front(), *batch);
+  batches_.pop_front();
+  not_full_.notify_one();
+  return true;
+}
+
+void BatchQueue::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  not_full_.notify_all();
+  not_empty_.notify_all();
+}
+
+bool BatchQueue::is_closed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return closed_;
+}
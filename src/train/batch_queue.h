@@ -0,0 +1,53 @@
+#ifndef BATCH_QUEUE_H
+#define BATCH_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "network/example_batch.h"
+
+// A bounded, thread-safe queue of training batches.  Producers block while the
+// queue is full and the consumer blocks while it is empty, so that example
+// generation runs at most max_size batches ahead of training.
+//
+// Batches that have been trained on are handed back to the producers to be
+// refilled, so that the batch buffers form a ring that is only allocated once.
+class BatchQueue
+{
+public:
+  explicit BatchQueue(const size_t max_size);
+
+  // Add a batch to the queue, waiting for space if the queue is full.
+  // The batch is swapped into the queue, and *batch is replaced by a batch that
+  // has been trained on (or an empty batch, if there is none).
+  // Returns false (without adding the batch) if the queue has been closed.
+  bool Push(ExampleBatch* batch);
+
+  // Remove the oldest batch from the queue, waiting for one if the queue is empty.
+  // The batch previously in *batch (if any) has been trained on, so it is
+  // recycled for the producers.
+  // Returns false if the queue has been closed.
+  bool Pop(ExampleBatch* batch);
+
+  // Wake up all waiting producers and consumers; all subsequent calls to
+  // Push and Pop fail.
+  void Close();
+
+  bool is_closed() const;
+
+private:
+  size_t max_size_;
+  std::deque<ExampleBatch> batches_;
+
+  // Batches that have been trained on, to be refilled.
+  std::vector<ExampleBatch> free_batches_;
+  bool closed_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+#endif // BATCH_QUEUE_H
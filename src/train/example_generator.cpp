@@ -29,11 +29,18 @@ void ExampleGenerator::Reset(const BoundingBox& bbox_prev,
                              const BoundingBox& bbox_curr,
                              const cv::Mat& image_prev,
                              const cv::Mat& image_curr) {
-  // Get padded target from previous image to feed the network.
-  CropPadImage(bbox_prev, image_prev, &target_pad_);
-
   // Save the current image.
   image_curr_ = image_curr;
+  pyramid_curr_ = ImagePyramid(image_curr);
+
+  // Get padded target from previous image to feed the network.
+  // For still images the previous and current images are the same, so the
+  // target is cropped from the same pyramid as the search regions.
+  if (image_prev.data == image_curr.data) {
+    CropPadImage(bbox_prev, pyramid_curr_, &target_pad_);
+  } else {
+    CropPadImage(bbox_prev, ImagePyramid(image_prev), &target_pad_);
+  }
 
   // Save the current ground-truth bounding box.
   bbox_curr_gt_ = bbox_curr;
@@ -42,6 +49,17 @@ void ExampleGenerator::Reset(const BoundingBox& bbox_prev,
   bbox_prev_gt_ = bbox_prev;
 }
 
+void ExampleGenerator::ResetWithTarget(const BoundingBox& bbox_prev,
+                                       const BoundingBox& bbox_curr,
+                                       const cv::Mat& target_pad,
+                                       const cv::Mat& image_curr) {
+  image_curr_ = image_curr;
+  pyramid_curr_ = ImagePyramid(image_curr);
+  target_pad_ = target_pad;
+  bbox_curr_gt_ = bbox_curr;
+  bbox_prev_gt_ = bbox_prev;
+}
+
 void ExampleGenerator::MakeTrainingExamples(const int num_examples,
                                             std::vector<cv::Mat>* images,
                                             std::vector<cv::Mat>* targets,
@@ -61,6 +79,32 @@ void ExampleGenerator::MakeTrainingExamples(const int num_examples,
   }
 }
 
+void ExampleGenerator::MakeTrainingExampleWarped(const cv::Size& output_size,
+                                                 cv::Mat* image,
+                                                 BoundingBox* bbox_gt_scaled) {
+  // Randomly transform the current image (translation and scale changes), as
+  // MakeTrainingExampleBBShift does.
+  BoundingBox bbox_curr_shift;
+  bbox_curr_gt_.Shift(image_curr_, lambda_scale_, lambda_shift_,
+                      min_scale_, max_scale_,
+                      shift_motion_model, &rng_,
+                      &bbox_curr_shift);
+
+  // Warp the search region at the shifted location directly to the output size.
+  BoundingBox rand_search_location;
+  double edge_spacing_x, edge_spacing_y;
+  cv::Size2d rand_search_size;
+  WarpCropPadImage(bbox_curr_shift, pyramid_curr_, output_size, image,
+                   &rand_search_location, &edge_spacing_x, &edge_spacing_y,
+                   &rand_search_size);
+
+  // Find the ground-truth bounding box location relative to the search region,
+  // scaled by the full-resolution size of the region.
+  BoundingBox bbox_gt_recentered;
+  bbox_curr_gt_.Recenter(rand_search_location, edge_spacing_x, edge_spacing_y, &bbox_gt_recentered);
+  bbox_gt_recentered.Scale(rand_search_size.width, rand_search_size.height, bbox_gt_scaled);
+}
+
 void ExampleGenerator::MakeTrueExample(cv::Mat* curr_search_region,
                                        cv::Mat* target_pad,
                                        BoundingBox* bbox_gt_scaled) const {
@@ -74,15 +118,18 @@ void ExampleGenerator::MakeTrueExample(cv::Mat* curr_search_region,
   // Crop the current image based on the prior estimate, with some padding
   // to define a search region within the current image.
   BoundingBox curr_search_location;
-  double edge_spacing_x, edge_spacing_y;
-  CropPadImage(curr_prior_tight, image_curr_, curr_search_region, &curr_search_location, &edge_spacing_x, &edge_spacing_y);
+  double edge_spacing_x, edge_spacing_y, search_region_scale;
+  CropPadImage(curr_prior_tight, pyramid_curr_, curr_search_region, &curr_search_location,
+               &edge_spacing_x, &edge_spacing_y, &search_region_scale);
 
   // Recenter the ground-truth bbox relative to the search location.
   BoundingBox bbox_gt_recentered;
   bbox_curr_gt_.Recenter(curr_search_location, edge_spacing_x, edge_spacing_y, &bbox_gt_recentered);
 
-  // Scale the bounding box relative to current crop.
-  bbox_gt_recentered.Scale(*curr_search_region, bbox_gt_scaled);
+  // Scale the bounding box relative to the full-resolution size of the current crop.
+  bbox_gt_recentered.Scale(curr_search_region->cols * search_region_scale,
+                           curr_search_region->rows * search_region_scale,
+                           bbox_gt_scaled);
 }
 
 void ExampleGenerator::get_default_bb_params(BBParams* default_params) const {
@@ -94,7 +141,7 @@ void ExampleGenerator::get_default_bb_params(BBParams* default_params) const {
 
 void ExampleGenerator::MakeTrainingExampleBBShift(cv::Mat* image_rand_focus,
                                                   cv::Mat* target_pad,
-                                                  BoundingBox* bbox_gt_scaled) const {
+                                                  BoundingBox* bbox_gt_scaled) {
 
   // Get default parameters for how much translation and scale change to apply to the
   // training example.
@@ -110,7 +157,7 @@ void ExampleGenerator::MakeTrainingExampleBBShift(cv::Mat* image_rand_focus,
 
 void ExampleGenerator::MakeTrainingExampleBBShift(
     const bool visualize_example, cv::Mat* image_rand_focus,
-    cv::Mat* target_pad, BoundingBox* bbox_gt_scaled) const {
+    cv::Mat* target_pad, BoundingBox* bbox_gt_scaled) {
   // Get default parameters for how much translation and scale change to apply to the
   // training example.
   BBParams default_bb_params;
@@ -126,28 +173,31 @@ void ExampleGenerator::MakeTrainingExampleBBShift(const bool visualize_example,
                                                   const BBParams& bbparams,
                                                   cv::Mat* rand_search_region,
                                                   cv::Mat* target_pad,
-                                                  BoundingBox* bbox_gt_scaled) const {
+                                                  BoundingBox* bbox_gt_scaled) {
   *target_pad = target_pad_;
 
   // Randomly transform the current image (translation and scale changes).
   BoundingBox bbox_curr_shift;
   bbox_curr_gt_.Shift(image_curr_, bbparams.lambda_scale, bbparams.lambda_shift,
                       bbparams.min_scale, bbparams.max_scale,
-                      shift_motion_model,
+                      shift_motion_model, &rng_,
                       &bbox_curr_shift);
 
   // Crop the image based at the new location (after applying translation and scale changes).
-  double edge_spacing_x, edge_spacing_y;
+  double edge_spacing_x, edge_spacing_y, search_region_scale;
   BoundingBox rand_search_location;
-  CropPadImage(bbox_curr_shift, image_curr_, rand_search_region, &rand_search_location,
-               &edge_spacing_x, &edge_spacing_y);
+  CropPadImage(bbox_curr_shift, pyramid_curr_, rand_search_region, &rand_search_location,
+               &edge_spacing_x, &edge_spacing_y, &search_region_scale);
 
   // Find the shifted ground-truth bounding box location relative to the image crop.
   BoundingBox bbox_gt_recentered;
   bbox_curr_gt_.Recenter(rand_search_location, edge_spacing_x, edge_spacing_y, &bbox_gt_recentered);
 
-  // Scale the ground-truth bounding box relative to the random transformation.
-  bbox_gt_recentered.Scale(*rand_search_region, bbox_gt_scaled);
+  // Scale the ground-truth bounding box relative to the random transformation
+  // (using the full-resolution size of the crop).
+  bbox_gt_recentered.Scale(rand_search_region->cols * search_region_scale,
+                           rand_search_region->rows * search_region_scale,
+                           bbox_gt_scaled);
 
   if (visualize_example) {
     VisualizeExample(*target_pad, *rand_search_region, *bbox_gt_scaled);
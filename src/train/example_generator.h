@@ -6,6 +6,8 @@
 #include <opencv2/highgui/highgui.hpp>
 
 #include "helper/bounding_box.h"
+#include "helper/image_pyramid.h"
+#include "helper/rng.h"
 #include "loader/loader_imagenet_det.h"
 #include "loader/video.h"
 
@@ -24,19 +26,30 @@ public:
   ExampleGenerator(const double lambda_shift, const double lambda_scale,
                    const double min_scale, const double max_scale);
 
+  // Seed the generator of the random transformations (see Rng).  Copies of an
+  // ExampleGenerator that are used concurrently should be given different streams.
+  void set_random_seed(const uint64_t seed, const uint64_t stream) {
+    rng_.Seed(seed, stream);
+  }
+
   // Set up to train on the previous and current image, and the previous and current bounding boxes.
   void Reset(const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
              const cv::Mat& image_prev, const cv::Mat& image_curr);
 
+  // Set up to train on the current image, with a target that has already been
+  // cropped from the previous image (e.g. by an earlier call to Reset).
+  void ResetWithTarget(const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
+                       const cv::Mat& target_pad, const cv::Mat& image_curr);
+
   // Shift the whole bounding box for the current frame
   // (simulates camera motion)
   void MakeTrainingExampleBBShift(const bool visualize_example,
                                   cv::Mat* image_rand_focus,
                                   cv::Mat* target_pad,
-                                  BoundingBox* bbox_gt_scaled) const;
+                                  BoundingBox* bbox_gt_scaled);
   void MakeTrainingExampleBBShift(cv::Mat* image_rand_focus,
                                   cv::Mat* target_pad,
-                                  BoundingBox* bbox_gt_scaled) const;
+                                  BoundingBox* bbox_gt_scaled);
 
   // Focus the current image at the location of the previous frame's
   // bounding box (true motion).
@@ -48,6 +61,17 @@ public:
                             std::vector<cv::Mat>* targets,
                             std::vector<BoundingBox>* bboxes_gt_scaled);
 
+  // Make a training example as MakeTrainingExampleBBShift does, but with the
+  // search region already resized to output_size, with a single affine warp of
+  // the current image's pyramid (see WarpCropPadImage).  The search region is
+  // written into image if it already has the right size and type (e.g. a view
+  // of a batch slot, see BatchAssembler::GetImageSlotBytes), and the example
+  // uses the target get_target().
+  void MakeTrainingExampleWarped(const cv::Size& output_size, cv::Mat* image,
+                                 BoundingBox* bbox_gt_scaled);
+
+  // Get the target (cropped from the previous image) for the current examples.
+  const cv::Mat& get_target() const { return target_pad_; }
 
   void set_indices(const int video_index, const int frame_index) {
     video_index_ = video_index; frame_index_ = frame_index;
@@ -58,7 +82,7 @@ private:
                                   const BBParams& bbparams,
                                   cv::Mat* image_rand_focus,
                                   cv::Mat* target_pad,
-                                  BoundingBox* bbox_gt_scaled) const;
+                                  BoundingBox* bbox_gt_scaled);
 
   void VisualizeExample(const cv::Mat& target_pad,
                         const cv::Mat& image_rand_focus,
@@ -79,6 +103,10 @@ private:
   // Current training image.
   cv::Mat image_curr_;
 
+  // Pyramid of the current training image; all search regions generated from
+  // this image are cropped from its pyramid levels.
+  ImagePyramid pyramid_curr_;
+
   // Location of the target within the current and previous images.
   BoundingBox bbox_curr_gt_;
   BoundingBox bbox_prev_gt_;
@@ -86,6 +114,9 @@ private:
   // Cropped and scaled image of the target object from the previous image.
   cv::Mat target_pad_;
 
+  // Generator for the random transformations.
+  Rng rng_;
+
   // Video and frame index from which the current example was generated.
   // These values are only used when saving images to a file, to assign them
   // a unique identifier.
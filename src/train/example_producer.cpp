@@ -0,0 +1,134 @@
+#include "example_producer.h"
+
+#include "helper/helper.h"
+
+TrackerTrainerQueued::TrackerTrainerQueued(ExampleGenerator* example_generator,
+                                           BatchQueue* batch_queue)
+  : TrackerTrainer(example_generator),
+    batch_queue_(batch_queue)
+{
+}
+
+void TrackerTrainerQueued::ProcessBatch() {
+  // Swap the batch into the queue, getting back a batch to refill.
+  // If the queue has been closed, training is over and the batch is dropped.
+  batch_queue_->Push(&batch_);
+}
+
+TrackerTrainerFanout::TrackerTrainerFanout(const std::vector<TrackerTrainer*>& tracker_trainers)
+  : tracker_trainers_(tracker_trainers)
+{
+}
+
+void TrackerTrainerFanout::Train(const cv::Mat& image_prev, const cv::Mat& image_curr,
+                                 const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
+                                 const uint64_t target_id) {
+  // The target does not depend on the example generator parameters, so it is
+  // only cropped by the first trainer.
+  tracker_trainers_[0]->Train(image_prev, image_curr, bbox_prev, bbox_curr, target_id);
+  const cv::Mat& target = tracker_trainers_[0]->get_target();
+  for (size_t i = 1; i < tracker_trainers_.size(); ++i) {
+    tracker_trainers_[i]->TrainWithTarget(target, image_curr, bbox_prev, bbox_curr, target_id);
+  }
+}
+
+void TrackerTrainerFanout::TrainWithTarget(const cv::Mat& target, const cv::Mat& image_curr,
+                                           const BoundingBox& bbox_prev,
+                                           const BoundingBox& bbox_curr,
+                                           const uint64_t target_id) {
+  for (size_t i = 0; i < tracker_trainers_.size(); ++i) {
+    tracker_trainers_[i]->TrainWithTarget(target, image_curr, bbox_prev, bbox_curr, target_id);
+  }
+}
+
+ExampleProducer::ExampleProducer(const ExampleGenerator& example_generator,
+                                 const SampleFunction& sample,
+                                 const uint64_t random_seed,
+                                 const uint64_t stream,
+                                 const size_t max_queued_batches)
+  : example_generators_(1, example_generator),
+    sample_(sample),
+    rng_(random_seed, 2 * stream),
+    first_core_(0),
+    num_cores_(0)
+{
+  Init(random_seed, stream, max_queued_batches);
+}
+
+ExampleProducer::ExampleProducer(const std::vector<ExampleGenerator>& example_generators,
+                                 const SampleFunction& sample,
+                                 const uint64_t random_seed,
+                                 const uint64_t stream,
+                                 const size_t max_queued_batches)
+  : example_generators_(example_generators),
+    sample_(sample),
+    rng_(random_seed, 2 * stream),
+    first_core_(0),
+    num_cores_(0)
+{
+  Init(random_seed, stream, max_queued_batches);
+}
+
+void ExampleProducer::Init(const uint64_t random_seed, const uint64_t stream,
+                           const size_t max_queued_batches) {
+  std::vector<TrackerTrainer*> tracker_trainers;
+  for (size_t i = 0; i < example_generators_.size(); ++i) {
+    example_generators_[i].set_random_seed(random_seed, 2 * stream + 1);
+    batch_queues_.push_back(boost::shared_ptr<BatchQueue>(new BatchQueue(max_queued_batches)));
+    tracker_trainers_.push_back(boost::shared_ptr<TrackerTrainerQueued>(
+        new TrackerTrainerQueued(&example_generators_[i], batch_queues_[i].get())));
+    tracker_trainers.push_back(tracker_trainers_[i].get());
+  }
+
+  if (tracker_trainers.size() > 1) {
+    fanout_trainer_.reset(new TrackerTrainerFanout(tracker_trainers));
+  }
+}
+
+ExampleProducer::~ExampleProducer() {
+  Stop();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ExampleProducer::set_training_stats(TrainingStats* training_stats) {
+  for (size_t i = 0; i < tracker_trainers_.size(); ++i) {
+    tracker_trainers_[i]->set_training_stats(training_stats);
+  }
+  if (fanout_trainer_) {
+    fanout_trainer_->set_training_stats(training_stats);
+  }
+}
+
+void ExampleProducer::set_batch_size(const int batch_size) {
+  for (size_t i = 0; i < tracker_trainers_.size(); ++i) {
+    tracker_trainers_[i]->set_batch_size(batch_size);
+  }
+}
+
+void ExampleProducer::Start() {
+  thread_ = std::thread(&ExampleProducer::Run, this);
+}
+
+bool ExampleProducer::Pop(const size_t config, ExampleBatch* batch) {
+  return batch_queues_[config]->Pop(batch);
+}
+
+void ExampleProducer::Stop() {
+  for (size_t i = 0; i < batch_queues_.size(); ++i) {
+    batch_queues_[i]->Close();
+  }
+}
+
+void ExampleProducer::Run() {
+  if (num_cores_ > 0) {
+    set_thread_affinity(first_core_, num_cores_);
+  }
+
+  TrackerTrainer* tracker_trainer = fanout_trainer_ ?
+      static_cast<TrackerTrainer*>(fanout_trainer_.get()) : tracker_trainers_[0].get();
+  while (!batch_queues_[0]->is_closed()) {
+    sample_(&rng_, tracker_trainer);
+  }
+}
@@ -0,0 +1,138 @@
+#ifndef EXAMPLE_PRODUCER_H
+#define EXAMPLE_PRODUCER_H
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "helper/rng.h"
+#include "train/batch_queue.h"
+#include "train/example_generator.h"
+#include "train/tracker_trainer.h"
+
+// A TrackerTrainer that, instead of training on each complete batch,
+// adds it to a queue to be trained on by another thread.
+class TrackerTrainerQueued : public TrackerTrainer
+{
+public:
+  TrackerTrainerQueued(ExampleGenerator* example_generator, BatchQueue* batch_queue);
+
+private:
+  // Add the batch to the queue.
+  virtual void ProcessBatch();
+
+  BatchQueue* batch_queue_;
+};
+
+// A TrackerTrainer that passes each example on to several trainers (e.g. with
+// different example generator parameters), so that the images are only
+// loaded and the target is only cropped once for all of them.
+class TrackerTrainerFanout : public TrackerTrainer
+{
+public:
+  explicit TrackerTrainerFanout(const std::vector<TrackerTrainer*>& tracker_trainers);
+
+  virtual void Train(const cv::Mat& image_prev, const cv::Mat& image_curr,
+                     const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
+                     const uint64_t target_id);
+
+  virtual void TrainWithTarget(const cv::Mat& target, const cv::Mat& image_curr,
+                               const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
+                               const uint64_t target_id);
+
+  virtual const cv::Mat& get_target() const { return tracker_trainers_[0]->get_target(); }
+
+private:
+  std::vector<TrackerTrainer*> tracker_trainers_;
+};
+
+// Generates training batches on a background thread.  Each producer owns its
+// own ExampleGenerator, random number generators, and queue, so any number of
+// producers can run concurrently, and each producer's sequence of batches
+// depends only on the random seed and its stream.
+//
+// A producer can also generate batches for several configurations (e.g. for
+// a hyperparameter sweep), each with its own example generator and queue, from
+// the same sampled images.
+class ExampleProducer
+{
+public:
+  // Samples a training example (e.g. loads a random pair of annotated frames)
+  // using the given random number generator, and passes it to the given trainer.
+  typedef std::function<void(Rng*, TrackerTrainer*)> SampleFunction;
+
+  // Generate examples with a copy of the given example generator, from the
+  // images chosen by sample, and queue up to max_queued_batches complete batches.
+  // The random numbers are drawn from streams 2 * stream (for sampling) and
+  // 2 * stream + 1 (for the transformations) of random_seed.
+  ExampleProducer(const ExampleGenerator& example_generator,
+                  const SampleFunction& sample,
+                  const uint64_t random_seed,
+                  const uint64_t stream,
+                  const size_t max_queued_batches);
+
+  // Generate batches for each of the given example generators, from the same
+  // images, with one queue per generator.  All generators draw the same random
+  // numbers for their transformations.
+  ExampleProducer(const std::vector<ExampleGenerator>& example_generators,
+                  const SampleFunction& sample,
+                  const uint64_t random_seed,
+                  const uint64_t stream,
+                  const size_t max_queued_batches);
+
+  // Stops the thread and waits for it to finish.
+  ~ExampleProducer();
+
+  // Record the time spent generating examples in the given stats (before Start).
+  void set_training_stats(TrainingStats* training_stats);
+
+  // Make batches of the given number of examples (before Start).
+  void set_batch_size(const int batch_size);
+
+  // Run the thread only on cores [first_core, first_core + num_cores) (before Start).
+  void set_cores(const int first_core, const int num_cores) {
+    first_core_ = first_core;
+    num_cores_ = num_cores;
+  }
+
+  // Start generating batches, until Stop is called.
+  void Start();
+
+  // Get the next batch, waiting for it to be generated (see BatchQueue::Pop).
+  bool Pop(ExampleBatch* batch) { return Pop(0, batch); }
+
+  // Get the next batch of the given configuration (the index of its example generator).
+  bool Pop(const size_t config, ExampleBatch* batch);
+
+  // Stop generating batches.
+  void Stop();
+
+private:
+  // Set up a queue and a trainer for each example generator.
+  void Init(const uint64_t random_seed, const uint64_t stream,
+            const size_t max_queued_batches);
+
+  // Thread body.
+  void Run();
+
+  // One of each per configuration.
+  std::vector<ExampleGenerator> example_generators_;
+  std::vector<boost::shared_ptr<BatchQueue> > batch_queues_;
+  std::vector<boost::shared_ptr<TrackerTrainerQueued> > tracker_trainers_;
+
+  // Passes the sampled examples to all configurations, if there are several.
+  boost::shared_ptr<TrackerTrainerFanout> fanout_trainer_;
+
+  SampleFunction sample_;
+  Rng rng_;
+
+  // Cores to run on; all cores if num_cores_ is 0.
+  int first_core_;
+  int num_cores_;
+
+  std::thread thread_;
+};
+
+#endif // EXAMPLE_PRODUCER_H
@@ -0,0 +1,92 @@
+#include "gradient_averager.h"
+
+#include <algorithm>
+
+using caffe::Blob;
+
+GradientAverager::ReplicaCallback::ReplicaCallback(GradientAverager* averager,
+                                                   const int replica)
+  : averager_(averager),
+    replica_(replica)
+{
+}
+
+void GradientAverager::ReplicaCallback::OnGradientsReady() {
+  averager_->AverageSlice(replica_);
+}
+
+GradientAverager::GradientAverager(const std::vector<RegressorTrainBase*>& replicas)
+  : num_values_(0),
+    num_waiting_(0),
+    generation_(0)
+{
+  // Parameters that are not trained (e.g. the convolutional layers) have no
+  // gradients to average.
+  params_.resize(replicas.size());
+  for (size_t i = 0; i < replicas.size(); ++i) {
+    replicas[i]->GetTrainedParams(&params_[i]);
+    CHECK_EQ(params_[i].size(), params_[0].size()) << "Replicas have different networks";
+  }
+
+  for (size_t j = 0; j < params_[0].size(); ++j) {
+    param_offsets_.push_back(num_values_);
+    num_values_ += params_[0][j]->count();
+  }
+
+  for (size_t i = 0; i < replicas.size(); ++i) {
+    callbacks_.push_back(boost::shared_ptr<ReplicaCallback>(new ReplicaCallback(this, i)));
+    replicas[i]->add_gradient_callback(callbacks_[i].get());
+  }
+}
+
+void GradientAverager::AverageSlice(const int replica) {
+  // Wait for all replicas to compute their gradients.
+  Wait();
+
+  // The range of values (over all parameter blobs) that this replica averages.
+  const int num_replicas = params_.size();
+  const size_t slice_begin = num_values_ * replica / num_replicas;
+  const size_t slice_end = num_values_ * (replica + 1) / num_replicas;
+  const float scale = 1.0 / num_replicas;
+
+  for (size_t j = 0; j < param_offsets_.size(); ++j) {
+    // Find the part of this blob that is within the slice.
+    const size_t blob_begin = param_offsets_[j];
+    const size_t blob_end = blob_begin + params_[0][j]->count();
+    const size_t begin = std::max(blob_begin, slice_begin);
+    const size_t end = std::min(blob_end, slice_end);
+    if (begin >= end) {
+      continue;
+    }
+    const int offset = begin - blob_begin;
+    const int count = end - begin;
+
+    // Sum the gradients of all replicas into the first replica, and scale them.
+    float* average = params_[0][j]->mutable_cpu_diff() + offset;
+    for (int i = 1; i < num_replicas; ++i) {
+      caffe::caffe_axpy(count, 1.0f, params_[i][j]->cpu_diff() + offset, average);
+    }
+    caffe::caffe_scal(count, scale, average);
+
+    // Copy the average back to the other replicas.
+    for (int i = 1; i < num_replicas; ++i) {
+      caffe::caffe_copy(count, average, params_[i][j]->mutable_cpu_diff() + offset);
+    }
+  }
+
+  // Wait for all slices to be averaged before any replica applies its update.
+  Wait();
+}
+
+void GradientAverager::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const int generation = generation_;
+  num_waiting_++;
+  if (num_waiting_ == static_cast<int>(params_.size())) {
+    num_waiting_ = 0;
+    generation_++;
+    cond_.notify_all();
+  } else {
+    cond_.wait(lock, [this, generation] { return generation_ != generation; });
+  }
+}
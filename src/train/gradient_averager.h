@@ -0,0 +1,68 @@
+#ifndef GRADIENT_AVERAGER_H
+#define GRADIENT_AVERAGER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <caffe/caffe.hpp>
+
+#include "network/regressor_train_base.h"
+
+// Synchronous data-parallel training: several replicas of the network, each
+// trained by its own thread on its own batches, average their gradients at
+// every step before applying the update.  The replicas start from the same
+// weights and apply the same updates, so their weights stay identical, and each
+// step trains on the batches of all replicas.
+//
+// The replicas' parameters are in shared memory, so no copies are made: the
+// parameters are split into one slice per replica, and each replica's thread
+// averages its slice over all replicas.
+class GradientAverager
+{
+public:
+  // Add a gradient callback to each of the replicas, which must all have the same
+  // network.  Each replica must then be trained (one step at a time) on its
+  // own thread, for the same number of steps.
+  explicit GradientAverager(const std::vector<RegressorTrainBase*>& replicas);
+
+private:
+  // Gradient callback of one replica.
+  class ReplicaCallback : public RegressorTrainBase::GradientCallback
+  {
+  public:
+    ReplicaCallback(GradientAverager* averager, const int replica);
+
+    virtual void OnGradientsReady();
+
+  private:
+    GradientAverager* averager_;
+    int replica_;
+  };
+
+  // Average the given replica's slice of the gradients, once all replicas have
+  // computed their gradients.
+  void AverageSlice(const int replica);
+
+  // Wait until all replicas have called this.
+  void Wait();
+
+  // Trained parameters of each replica.
+  std::vector<std::vector<caffe::Blob<float>*> > params_;
+
+  // Start of each parameter blob, counting the values of all blobs in order.
+  std::vector<size_t> param_offsets_;
+  size_t num_values_;
+
+  std::vector<boost::shared_ptr<ReplicaCallback> > callbacks_;
+
+  // Barrier: number of replicas waiting, and the number of times that all
+  // replicas have arrived.
+  int num_waiting_;
+  int generation_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+#endif // GRADIENT_AVERAGER_H
@@ -0,0 +1,91 @@
+#include "hard_example_sampler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+#include "train/target_cache.h"
+
+namespace {
+
+int CountAnnotations(const std::vector<int>& num_annotations) {
+  int total = 0;
+  for (size_t i = 0; i < num_annotations.size(); ++i) {
+    total += num_annotations[i];
+  }
+  return total;
+}
+
+} // namespace
+
+HardExampleSampler::HardExampleSampler(const int dataset,
+                                       const std::vector<int>& num_annotations,
+                                       const double uniform_fraction,
+                                       const double initial_loss)
+  : dataset_(dataset),
+    uniform_fraction_(uniform_fraction),
+    losses_(CountAnnotations(num_annotations), initial_loss),
+    num_updated_(0),
+    updated_(losses_.get_num_leaves(), false)
+{
+  int offset = 0;
+  for (size_t i = 0; i < num_annotations.size(); ++i) {
+    item_offsets_.push_back(offset);
+    offset += num_annotations[i];
+  }
+}
+
+void HardExampleSampler::Sample(Rng* rng, int* item_num, int* annotation_num) {
+  int index;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rng->Uniform() < uniform_fraction_ || losses_.get_total() <= 0) {
+      index = rng->UniformInt(losses_.get_num_leaves());
+    } else {
+      index = losses_.Find(rng->Uniform() * losses_.get_total());
+    }
+  }
+
+  // Find the item that contains this annotation (the last one that starts at
+  // or before it, skipping items without annotations).
+  const std::vector<int>::const_iterator it =
+      std::upper_bound(item_offsets_.begin(), item_offsets_.end(), index) - 1;
+  *item_num = it - item_offsets_.begin();
+  *annotation_num = index - *it;
+}
+
+void HardExampleSampler::Update(const std::vector<uint64_t>& target_ids,
+                                const std::vector<float>& losses, const int num) {
+  // An annotation has several examples (with different shifts) in a batch, so
+  // its loss is the mean over its examples.
+  std::map<int, std::pair<double, int> > annotation_losses;
+  for (int i = 0; i < num; ++i) {
+    int dataset, item_num, annotation_num;
+    TargetCache::ParseKey(target_ids[i], &dataset, &item_num, &annotation_num);
+    if (dataset != dataset_) {
+      continue;
+    }
+    std::pair<double, int>& annotation_loss =
+        annotation_losses[item_offsets_[item_num] + annotation_num];
+    annotation_loss.first += losses[i];
+    annotation_loss.second++;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (std::map<int, std::pair<double, int> >::const_iterator it = annotation_losses.begin();
+       it != annotation_losses.end(); ++it) {
+    losses_.Set(it->first, it->second.first / it->second.second);
+    if (!updated_[it->first]) {
+      updated_[it->first] = true;
+      num_updated_++;
+    }
+  }
+}
+
+void HardExampleSampler::PrintStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int num_annotations = losses_.get_num_leaves();
+  printf("Hard example sampler (dataset %d): %d / %d annotations trained on, mean loss %.3lf\n",
+         dataset_, num_updated_, num_annotations,
+         num_annotations > 0 ? losses_.get_total() / num_annotations : 0.0);
+}
@@ -0,0 +1,64 @@
+#ifndef HARD_EXAMPLE_SAMPLER_H
+#define HARD_EXAMPLE_SAMPLER_H
+
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+#include "helper/rng.h"
+#include "helper/sum_tree.h"
+
+// Samples the annotations of a dataset (e.g. the objects in the training
+// images, or the pairs of consecutive annotated frames in the training videos)
+// in proportion to the most recent training loss of their examples, so that
+// training spends its batches on the examples that the network still gets
+// wrong, rather than on those it has already learned.
+//
+// Each annotation is sampled with probability
+//   uniform_fraction / N + (1 - uniform_fraction) * loss / (sum of all losses),
+// so that every annotation keeps being sampled (and its loss re-estimated)
+// even once its loss is low.  Annotations that have not been trained on yet
+// have a loss of initial_loss.
+//
+// Sampling and updating are thread-safe, and take O(log N) time.
+class HardExampleSampler
+{
+public:
+  // Item i (an image or a video) of the given dataset (see TargetCache::MakeKey)
+  // has num_annotations[i] annotations.
+  HardExampleSampler(const int dataset, const std::vector<int>& num_annotations,
+                     const double uniform_fraction, const double initial_loss);
+
+  // Choose an annotation.
+  void Sample(Rng* rng, int* item_num, int* annotation_num);
+
+  // Set the loss of the annotations of the first num examples of a batch, from
+  // the loss of each example (see RegressorTrainBase::GetExampleLosses).  The
+  // examples are identified by their target ids, which must be made by
+  // TargetCache::MakeKey; examples of other datasets are ignored.
+  void Update(const std::vector<uint64_t>& target_ids, const std::vector<float>& losses,
+              const int num);
+
+  // Print the mean loss of the annotations.
+  void PrintStats() const;
+
+private:
+  int dataset_;
+
+  // Index of the first annotation of each item, in the order of the items.
+  std::vector<int> item_offsets_;
+
+  double uniform_fraction_;
+
+  // Loss of each annotation, by index.
+  SumTree losses_;
+
+  // Number of annotations that have been trained on.
+  int num_updated_;
+  std::vector<bool> updated_;
+
+  mutable std::mutex mutex_;
+};
+
+#endif // HARD_EXAMPLE_SAMPLER_H
@@ -1,53 +1,96 @@
+// Pretrain the neural network tracker without labels, on random boxes in the
+// frames of a folder of unlabeled images and videos (e.g. robot footage).
+// As for the ImageNet images in train, the tracker learns to find each box in
+// shifted and rescaled crops of the same frame.
+
 #include <string>
 #include <iostream>
+#include <thread>
 
 #include <caffe/caffe.hpp>
 
 #include "example_generator.h"
 #include "helper/helper.h"
-#include "loader/loader_imagenet_det.h"
-#include "loader/rgbd_loader.h"
+#include "loader/loader_unlabeled.h"
 #include "network/regressor_train.h"
+#include "train/example_producer.h"
+#include "train/training_stats.h"
 #include "train/tracker_trainer.h"
-#include "tracker/tracker_manager.h"
 
 using std::string;
 
 namespace {
 
-// 450,000 batches * (50 images / batch) / (10 images / example) = n examples.
-const int kNumIters = 450000 * 5;
+// Desired number of training steps (batches, without gradient accumulation).
+const int kNumBatches = 450000;
+
+// Maximum number of complete batches waiting to be trained on, per producer thread.
+const int kQueuedBatchesPerThread = 2;
+
+// How often to print the training throughput, in batches, if the solver does
+// not set a display interval.
+const int kDefaultStatsInterval = 100;
+
+// Number of streams reading frames, per producer thread.
+const int kStreamsPerThread = 2;
+
+// Only every kFrameStride-th video frame is used.
+const int kFrameStride = 5;
 
-// Train on a random image.
-void preTrainImage(const LoaderImagenetDet& image_loader,
-           const std::vector<std::vector<Annotation> >& images,
-           TrackerTrainer* tracker_trainer) {
-  // Choose a random image.
-  const int image_num = rand() % images.size();
+// Range of the size of the random boxes, as a fraction of the frame size.
+const double kMinBoxFraction = 0.1;
+const double kMaxBoxFraction = 0.5;
 
-  // Load the image.
-  cv::Mat image;
-  image_loader.getImage(image_num, &image);
+// Sample a random box in the frame.
+void SampleRandomBox(const cv::Mat& frame, Rng* rng, BoundingBox* bbox) {
+  const double width = frame.cols * (kMinBoxFraction +
+                                     rng->Uniform() * (kMaxBoxFraction - kMinBoxFraction));
+  const double height = frame.rows * (kMinBoxFraction +
+                                      rng->Uniform() * (kMaxBoxFraction - kMinBoxFraction));
+  bbox->x1_ = rng->Uniform() * (frame.cols - width);
+  bbox->y1_ = rng->Uniform() * (frame.rows - height);
+  bbox->x2_ = bbox->x1_ + width;
+  bbox->y2_ = bbox->y1_ + height;
+}
+
+// Train on a random box in the next frame.
+void pretrain_frame(LoaderUnlabeled* loader, Rng* rng, TrackerTrainer* tracker_trainer) {
+  cv::Mat frame;
+  TrainingStats* training_stats = tracker_trainer->get_training_stats();
+  bool has_frame;
+  {
+    StageTimer timer(training_stats, TrainingStats::kStageDecode);
+    has_frame = loader->ReadFrame(rng, &frame);
+  }
+  if (!has_frame) {
+    printf("Error - could not read a frame\n");
+    return;
+  }
+  if (training_stats) {
+    training_stats->AddImages(1);
+  }
 
-  // Get a random bounding box for this image.
   BoundingBox bbox;
-  bbox.rand(image);
+  SampleRandomBox(frame, rng, &bbox);
 
-  // Train on this example
-  tracker_trainer->train(image, image, bbox, bbox);
+  // Each box is only trained on once, so its target is identified by a random id.
+  tracker_trainer->Train(frame, frame, bbox, bbox, rng->Next());
 }
 
 } // namespace
 
 int main (int argc, char *argv[]) {
-  if (argc < 13) {
+  if (argc < 11) {
     std::cerr << "Usage: " << argv[0]
-              << " videos_folder_imagenet annotations_folder_imagenet"
-              << " train_deploy.prototxt network.caffemodel"
-              << " mean.binaryproto solver_file"
+              << " unlabeled_folder"
+              << " network.caffemodel train.prototxt solver_file"
               << " lambda_shift lambda_scale min_scale max_scale"
-              << " gpu_id random_seed"
+              << " gpu_id random_seed [num_threads]"
+              << std::endl;
+    std::cerr << "unlabeled_folder is searched (with its subfolders) for images and videos."
               << std::endl;
+    std::cerr << "num_threads is the number of threads generating training examples"
+              << " (default: one less than the number of cores)." << std::endl;
     return 1;
   }
 
@@ -56,12 +99,9 @@ int main (int argc, char *argv[]) {
   ::google::InitGoogleLogging(argv[0]);
 
   int arg_index = 1;
-  const string& images_folder_imagenet      = argv[arg_index++];
-  const string& annotations_folder_imagenet = argv[arg_index++];
+  const string& unlabeled_folder = argv[arg_index++];
   const string& caffe_model   = argv[arg_index++];
-  const string& deploy_proto   = argv[arg_index++];
-  const string& test_proto = argv[arg_index++];
-  const string& mean_file    = argv[arg_index++];
+  const string& train_proto   = argv[arg_index++];
   const string& solver_file  = argv[arg_index++];
   const double lambda_shift        = atof(argv[arg_index++]);
   const double lambda_scale        = atof(argv[arg_index++]);
@@ -69,40 +109,73 @@ int main (int argc, char *argv[]) {
   const double max_scale           = atof(argv[arg_index++]);
   const int gpu_id          = atoi(argv[arg_index++]);
   const int random_seed          = atoi(argv[arg_index++]);
+  const int num_threads = std::max(1, argc > arg_index ? atoi(argv[arg_index++]) :
+      static_cast<int>(std::thread::hardware_concurrency()) - 1);
 
-  caffe::Caffe::set_random_seed(random_seed); 
+  caffe::Caffe::set_random_seed(random_seed);
   printf("Using random seed: %d\n", random_seed);
 
-#ifdef CPU_ONLY
-  printf("Setting up Caffe in CPU mode\n");
-  caffe::Caffe::set_mode(caffe::Caffe::CPU);
-#else
-  printf("Setting up Caffe in GPU mode with ID: %d\n", gpu_id);
-  caffe::Caffe::set_mode(caffe::Caffe::GPU);
-  caffe::Caffe::SetDevice(gpu_id);
-#endif
-
-  // Load the ImageNet data.
-  LoaderImagenetDet image_loader(images_folder_imagenet, annotations_folder_imagenet);
-  const std::vector<std::vector<Annotation> >& train_images = image_loader.get_images();
+  // Find the unlabeled frames.
+  LoaderUnlabeled loader(unlabeled_folder, num_threads * kStreamsPerThread, kFrameStride);
+  if (loader.get_num_images() == 0 && loader.get_num_videos() == 0) {
+    std::cerr << "No images or videos found in " << unlabeled_folder << std::endl;
+    return 1;
+  }
 
   // Create an example generator.
   ExampleGenerator example_generator(lambda_shift, lambda_scale,
                                      min_scale, max_scale);
 
   printf("Setting up training objects\n");
-  RegressorTrain regressor_train(deploy_proto, caffe_model, mean_file,
-                                 gpu_id, solver_file);
-  regressor_train.set_test_net(test_proto);
-
-  TrackerTrainer tracker_trainer(&example_generator, &regressor_train);
-  //TrackerManagerTrainer track_manager(train_videos, &regressor, &tracker_trainer);
-  //track_manager.set_use_gt_target(true);
+  RegressorTrain regressor_train(train_proto, caffe_model, gpu_id, solver_file);
+
+  const caffe::SolverParameter& solver_param = regressor_train.get_solver_param();
+  const int display_interval = solver_param.display() > 0 ? solver_param.display() :
+                                                            kDefaultStatsInterval;
+
+  // With gradient accumulation, each solver step trains on iter_size batches,
+  // which are what the training loop counts.
+  const int iter_size = regressor_train.get_batches_per_step();
+  const int num_batches_to_train = kNumBatches * iter_size;
+  const int stats_interval = display_interval * iter_size;
+  TrainingStats training_stats;
+  training_stats.OpenCsv(solver_param.snapshot_prefix() + "_stats.csv");
+
+  // Generate the batches on num_threads producer threads, while this thread
+  // only runs the solver.
+  printf("Generating training examples on %d threads\n", num_threads);
+  ExampleProducer::SampleFunction sample = [&](Rng* rng, TrackerTrainer* tracker_trainer) {
+    pretrain_frame(&loader, rng, tracker_trainer);
+  };
+  std::vector<boost::shared_ptr<ExampleProducer> > producers;
+  for (int i = 0; i < num_threads; ++i) {
+    producers.push_back(boost::shared_ptr<ExampleProducer>(
+        new ExampleProducer(example_generator, sample, random_seed, i,
+                            kQueuedBatchesPerThread)));
+    producers.back()->set_training_stats(&training_stats);
+    producers.back()->Start();
+  }
 
-  for (int i = 0; i < kNumIters; ++i) {
-    preTrainImage(image_loader, train_images, &tracker_trainer);
+  // Train on the batches of the producers in turn.
+  ExampleBatch batch;
+  for (int num_batches = 1; num_batches <= num_batches_to_train; ++num_batches) {
+    {
+      StageTimer timer(&training_stats, TrainingStats::kStageWait);
+      producers[(num_batches - 1) % num_threads]->Pop(&batch);
+    }
+    {
+      StageTimer timer(&training_stats, TrainingStats::kStageSolver);
+      regressor_train.Train(batch);
+    }
+    training_stats.AddBatches(1);
+
+    if (num_batches % stats_interval == 0) {
+      training_stats.Report(num_batches);
+    }
   }
 
+  // Stop the producers (their destructors wait for them to finish).
+  producers.clear();
+
   return 0;
 }
-
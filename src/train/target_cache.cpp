@@ -0,0 +1,86 @@
+#include "target_cache.h"
+
+#include <cstdio>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+DEFINE_uint64(target_cache_size, 10000,
+              "Maximum number of target crops to keep for annotations that are sampled "
+              "again (at 227x227x3 bytes each, 10000 crops take about 1.5 GB); 0 disables "
+              "the cache.");
+
+TargetCache::TargetCache(const size_t max_entries, const cv::Size& target_size)
+  : max_entries_(max_entries),
+    target_size_(target_size),
+    num_hits_(0),
+    num_misses_(0)
+{
+}
+
+uint64_t TargetCache::MakeKey(const int dataset, const int item_num, const int annotation_num) {
+  return (static_cast<uint64_t>(dataset) << 56) |
+         (static_cast<uint64_t>(item_num) << 24) |
+         static_cast<uint64_t>(annotation_num);
+}
+
+void TargetCache::ParseKey(const uint64_t key, int* dataset, int* item_num, int* annotation_num) {
+  *dataset = key >> 56;
+  *item_num = (key >> 24) & 0xffffffffULL;
+  *annotation_num = key & 0xffffffULL;
+}
+
+bool TargetCache::Find(const uint64_t key, cv::Mat* target) {
+  if (max_entries_ == 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<uint64_t, EntryList::iterator>::const_iterator it = index_.find(key);
+  if (it == index_.end()) {
+    num_misses_++;
+    return false;
+  }
+
+  // Move the entry to the front of the list.
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *target = it->second->second;
+  num_hits_++;
+  return true;
+}
+
+void TargetCache::Insert(const uint64_t key, const cv::Mat& target) {
+  if (max_entries_ == 0) {
+    return;
+  }
+
+  // Resize outside of the lock.
+  cv::Mat target_resized;
+  cv::resize(target, target_resized, target_size_);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index_.count(key) > 0) {
+    // Another thread inserted this target in the meantime.
+    return;
+  }
+
+  entries_.push_front(std::make_pair(key, target_resized));
+  index_[key] = entries_.begin();
+
+  // Evict the least recently used target.
+  if (entries_.size() > max_entries_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+void TargetCache::PrintStats() const {
+  if (max_entries_ == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int num_lookups = num_hits_ + num_misses_;
+  printf("Target cache: %zu entries, %d hits, %d misses (%.1lf%% hit rate)\n",
+         entries_.size(), num_hits_, num_misses_,
+         num_lookups > 0 ? 100.0 * num_hits_ / num_lookups : 0.0);
+}
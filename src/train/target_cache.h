@@ -0,0 +1,62 @@
+#ifndef TARGET_CACHE_H
+#define TARGET_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <stdint.h>
+
+#include <gflags/gflags.h>
+#include <opencv2/core/core.hpp>
+
+// Maximum number of target crops that the training tools cache (0 disables
+// the cache).
+DECLARE_uint64(target_cache_size);
+
+// A bounded, thread-safe cache of target crops, keyed by annotation.
+// The target crop for an annotation depends only on the annotated image and
+// bounding box, so when an annotation is sampled again, the crop (and, for
+// videos, decoding the previous frame) can be skipped.
+// When the cache is full, the least recently used crop is evicted.
+class TargetCache
+{
+public:
+  // Keep at most max_entries crops, each resized to target_size (the network
+  // input size, so that memory use is bounded and resizing is only done once).
+  // If max_entries is 0, nothing is cached.
+  TargetCache(const size_t max_entries, const cv::Size& target_size);
+
+  // Make a key identifying annotation annotation_num of item item_num
+  // (an image or a video) of the given dataset.
+  static uint64_t MakeKey(const int dataset, const int item_num, const int annotation_num);
+
+  // Get the dataset, item and annotation identified by a key made by MakeKey.
+  static void ParseKey(const uint64_t key, int* dataset, int* item_num, int* annotation_num);
+
+  // Find the target for the given key.  Returns false if it is not cached.
+  bool Find(const uint64_t key, cv::Mat* target);
+
+  // Add the target for the given key.
+  void Insert(const uint64_t key, const cv::Mat& target);
+
+  // Print the number of hits and misses.
+  void PrintStats() const;
+
+private:
+  typedef std::list<std::pair<uint64_t, cv::Mat> > EntryList;
+
+  size_t max_entries_;
+  cv::Size target_size_;
+
+  // Entries, from most to least recently used.
+  EntryList entries_;
+  std::unordered_map<uint64_t, EntryList::iterator> index_;
+
+  int num_hits_;
+  int num_misses_;
+
+  mutable std::mutex mutex_;
+};
+
+#endif // TARGET_CACHE_H
@@ -4,117 +4,144 @@
 
 #include "network/regressor.h"
 
-// Number of images in each batch.
+// Number of images in each batch, by default.
 const int kBatchSize = 50;
 
+// Size of the network inputs.
+const int kInputSize = 227;
+
 // Number of examples that we generate (by applying synthetic transformations)
 // to each image.
 const int kGeneratedExamplesPerImage = 10;
 
+TrackerTrainer::TrackerTrainer()
+  : batch_assembler_(kBatchSize, cv::Size(kInputSize, kInputSize)),
+    example_generator_(NULL),
+    regressor_train_(NULL),
+    num_batches_(0),
+    training_stats_(NULL)
+{
+}
+
 TrackerTrainer::TrackerTrainer(ExampleGenerator* example_generator)
-  : example_generator_(example_generator),
-    num_batches_(0)
+  : batch_assembler_(kBatchSize, cv::Size(kInputSize, kInputSize)),
+    example_generator_(example_generator),
+    regressor_train_(NULL),
+    num_batches_(0),
+    training_stats_(NULL)
 {
+  batch_assembler_.Reset(&batch_);
 }
 
 TrackerTrainer::TrackerTrainer(ExampleGenerator* example_generator,
                                RegressorTrainBase* regressor_train)
-  : example_generator_(example_generator),
+  : batch_assembler_(kBatchSize, cv::Size(kInputSize, kInputSize)),
+    example_generator_(example_generator),
     regressor_train_(regressor_train),
-    num_batches_(0)
+    num_batches_(0),
+    training_stats_(NULL)
 {
+  batch_assembler_.Reset(&batch_);
 }
 
-void TrackerTrainer::MakeTrainingExamples(std::vector<cv::Mat>* images,
-                                          std::vector<cv::Mat>* targets,
-                                          std::vector<BoundingBox>* bboxes_gt_scaled) {
-  // Generate true example.
-  cv::Mat image;
-  cv::Mat target;
-  BoundingBox bbox_gt_scaled;
-  example_generator_->MakeTrueExample(&image, &target, &bbox_gt_scaled);
-  images->push_back(image);
-  targets->push_back(target);
-  bboxes_gt_scaled->push_back(bbox_gt_scaled);
-
-  // Generate additional training examples through synthetic transformations.
-  example_generator_->MakeTrainingExamples(kGeneratedExamplesPerImage, images,
-                                           targets, bboxes_gt_scaled);
+void TrackerTrainer::set_batch_size(const int batch_size) {
+  CHECK_EQ(batch_.num, 0) << "The batch size must be set before adding examples";
+  batch_assembler_ = BatchAssembler(batch_size, cv::Size(kInputSize, kInputSize));
+  batch_assembler_.Reset(&batch_);
 }
 
 void TrackerTrainer::ProcessBatch() {
   // Train the neural network tracker with these examples.
-  regressor_train_->Train(images_batch_, targets_batch_,
-                          bboxes_gt_scaled_batch_);
+  {
+    StageTimer timer(training_stats_, TrainingStats::kStageSolver);
+    regressor_train_->Train(batch_);
+  }
+
+  // Sample the examples that the network gets most wrong more often.
+  if (!hard_example_samplers_.empty()) {
+    regressor_train_->GetExampleLosses(&example_losses_);
+    for (size_t i = 0; i < hard_example_samplers_.size(); ++i) {
+      hard_example_samplers_[i]->Update(batch_.target_ids, example_losses_, batch_.num);
+    }
+  }
+  if (training_stats_) {
+    training_stats_->AddBatches(1);
+  }
 }
 
 void TrackerTrainer::Train(const cv::Mat& image_prev, const cv::Mat& image_curr,
-                           const BoundingBox& bbox_prev, const BoundingBox& bbox_curr) {
-  // Check that the saved batches are of appropriate dimensions.
-  CHECK_EQ(images_batch_.size(), targets_batch_.size())
-      << " images_batch: " << images_batch_.size() <<
-         " targets_batch: " << targets_batch_.size();
+                           const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
+                           const uint64_t target_id) {
+  // Set up example generator.
+  {
+    StageTimer timer(training_stats_, TrainingStats::kStageCrop);
+    example_generator_->Reset(bbox_prev,
+                             bbox_curr,
+                             image_prev,
+                             image_curr);
+  }
 
-  CHECK_EQ(images_batch_.size(), bboxes_gt_scaled_batch_.size())
-      << " images_batch: " << images_batch_.size() <<
-         " bboxes_gt_scaled_batch_: " << bboxes_gt_scaled_batch_.size();
+  AddExamples(target_id);
+}
 
+void TrackerTrainer::TrainWithTarget(const cv::Mat& target, const cv::Mat& image_curr,
+                                     const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
+                                     const uint64_t target_id) {
   // Set up example generator.
-  example_generator_->Reset(bbox_prev,
-                           bbox_curr,
-                           image_prev,
-                           image_curr);
-
-  // Make training examples.
-  std::vector<cv::Mat> images;
-  std::vector<cv::Mat> targets;
-  std::vector<BoundingBox> bboxes_gt_scaled;
-  MakeTrainingExamples(&images, &targets, &bboxes_gt_scaled);
-
-  while (images.size() > 0) {
-    // Compute the number of images left to complete the batch.
-    const int num_in_batch = images_batch_.size();
-    const int num_left_in_batch = kBatchSize - num_in_batch;
-
-    // The number of images to use is upper-bounded by the number left in the batch.
-    // The rest go into the next batch.
-    const int num_use = std::min(static_cast<int>(images.size()), num_left_in_batch);
-
-    if (num_use < 0) {
-      printf("Error: num_use: %d\n", num_use);
-    }
+  {
+    StageTimer timer(training_stats_, TrainingStats::kStageCrop);
+    example_generator_->ResetWithTarget(bbox_prev, bbox_curr, target, image_curr);
+  }
+
+  AddExamples(target_id);
+}
 
-    // Add the approrpriate number of images to the batch.
-    images_batch_.insert(images_batch_.end(),
-                         images.begin(), images.begin() + num_use);
-    targets_batch_.insert(targets_batch_.end(),
-                          targets.begin(), targets.begin() + num_use);
-    bboxes_gt_scaled_batch_.insert(bboxes_gt_scaled_batch_.end(),
-                                   bboxes_gt_scaled.begin(),
-                                   bboxes_gt_scaled.begin() + num_use);
-
-    // If we have a full batch, then train!  Otherwise, save this batch for later.
-    if (images_batch_.size() == kBatchSize) {
-      // Increment the batch count.
-      num_batches_++;
-
-      // We have filled up a complete batch, so we should train.
-      ProcessBatch();
-
-      // After training, clear the batch.
-      images_batch_.clear();
-      targets_batch_.clear();
-      bboxes_gt_scaled_batch_.clear();
-
-      // Reserve the appropriate amount of space for the next batch.
-      images_batch_.reserve(kBatchSize);
-      targets_batch_.reserve(kBatchSize);
-      bboxes_gt_scaled_batch_.reserve(kBatchSize);
+void TrackerTrainer::AddExamples(const uint64_t target_id) {
+  // Generate true example.
+  cv::Mat image;
+  cv::Mat target;
+  BoundingBox bbox_gt_scaled;
+  {
+    StageTimer timer(training_stats_, TrainingStats::kStageCrop);
+    example_generator_->MakeTrueExample(&image, &target, &bbox_gt_scaled);
+  }
+  AddExample(image, target, target_id, bbox_gt_scaled);
+
+  // Generate additional training examples through synthetic transformations,
+  // with each search region warped directly into its slot of the batch, at the
+  // network input size.
+  for (int i = 0; i < kGeneratedExamplesPerImage; ++i) {
+    cv::Mat search_region = batch_assembler_.GetImageSlotBytes(&batch_);
+    {
+      StageTimer timer(training_stats_, TrainingStats::kStageCrop);
+      example_generator_->MakeTrainingExampleWarped(cv::Size(kInputSize, kInputSize),
+                                                    &search_region, &bbox_gt_scaled);
     }
+    AddExample(search_region, target, target_id, bbox_gt_scaled);
+  }
+}
+
+void TrackerTrainer::AddExample(const cv::Mat& image, const cv::Mat& target,
+                                const uint64_t target_id,
+                                const BoundingBox& bbox_gt_scaled) {
+  bool batch_full;
+  {
+    StageTimer timer(training_stats_, TrainingStats::kStagePreprocess);
+    batch_full = batch_assembler_.Add(image, target, target_id, bbox_gt_scaled, &batch_);
+  }
+  if (training_stats_) {
+    training_stats_->AddExamples(1);
+  }
+
+  // If we have a full batch, then train!  Otherwise, save this batch for later.
+  if (batch_full) {
+    // Increment the batch count.
+    num_batches_++;
+
+    // We have filled up a complete batch, so we should train.
+    ProcessBatch();
 
-    // Remove the images that were used.
-    images.erase(images.begin(), images.begin() + num_use);
-    targets.erase(targets.begin(), targets.begin() + num_use);
-    bboxes_gt_scaled.erase(bboxes_gt_scaled.begin(), bboxes_gt_scaled.begin() + num_use);
+    // After training, start a new batch (reusing the allocated buffers).
+    batch_assembler_.Reset(&batch_);
   }
 }
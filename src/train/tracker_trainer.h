@@ -7,7 +7,11 @@
 
 #include "helper/bounding_box.h"
 #include "tracker/tracker.h"
+#include "network/example_batch.h"
 #include "network/regressor_train_base.h"
+#include "train/batch_assembler.h"
+#include "train/hard_example_sampler.h"
+#include "train/training_stats.h"
 
 class TrackerTrainer
 {
@@ -18,28 +22,61 @@ public:
                  RegressorTrainBase* regressor_train);
 
   // Train from this example.
-  // Inputs: previous image, current image, previous image's bounding box, current image's bounding box.
-  void Train(const cv::Mat& image_prev, const cv::Mat& image_curr,
-             const BoundingBox& bbox_prev, const BoundingBox& bbox_curr);
+  // Inputs: previous image, current image, previous image's bounding box, current image's bounding box,
+  // and an id that identifies the target (the crop of the previous image around its bounding box).
+  virtual void Train(const cv::Mat& image_prev, const cv::Mat& image_curr,
+                     const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
+                     const uint64_t target_id);
+
+  // Train from this example, with a target that has already been cropped from
+  // the previous image (e.g. a target saved from get_target).
+  virtual void TrainWithTarget(const cv::Mat& target, const cv::Mat& image_curr,
+                               const BoundingBox& bbox_prev, const BoundingBox& bbox_curr,
+                               const uint64_t target_id);
+
+  // Get the target that was cropped for the most recent example.
+  virtual const cv::Mat& get_target() const { return example_generator_->get_target(); }
 
   // Number of total batches trained on so far.
   int get_num_batches() { return num_batches_; }
 
-private:
-  // Generate training examples and return them.
-  // Note that we do not clear the input variables, so if they already contain
-  // some examples then we will append to them.
-  virtual void MakeTrainingExamples(std::vector<cv::Mat>* images,
-                            std::vector<cv::Mat>* targets,
-                            std::vector<BoundingBox>* bboxes_gt_scaled);
+  // Make batches of the given number of examples (before any examples are
+  // added).  With gradient accumulation (the solver's iter_size), these are
+  // the micro-batches, and each solver step trains on iter_size of them.
+  void set_batch_size(const int batch_size);
+
+  // Record the time spent in each stage, and the number of examples, in the
+  // given stats (or nothing if NULL, the default).
+  void set_training_stats(TrainingStats* training_stats) { training_stats_ = training_stats; }
+  TrainingStats* get_training_stats() const { return training_stats_; }
+
+  // After training on each batch, update the loss estimates of the given
+  // samplers with the loss of each example (none by default).
+  void set_hard_example_samplers(const std::vector<HardExampleSampler*>& samplers) {
+    hard_example_samplers_ = samplers;
+  }
+
+protected:
+  // For subclasses that pass the examples on to other trainers, rather than
+  // making batches themselves (so no batch buffers are allocated).
+  TrackerTrainer();
+
+  // Make training examples from the current state of the example generator,
+  // and add them to the batch (training on each batch as it is filled).
+  void AddExamples(const uint64_t target_id);
+
+  // Add a single example to the batch.
+  void AddExample(const cv::Mat& image, const cv::Mat& target, const uint64_t target_id,
+                  const BoundingBox& bbox_gt_scaled);
 
   // Train on the batch.
   virtual void ProcessBatch();
 
-  // Data in the current training batch.
-  std::vector<cv::Mat> images_batch_;
-  std::vector<cv::Mat> targets_batch_;
-  std::vector<BoundingBox> bboxes_gt_scaled_batch_;
+  // Preprocesses each example into the current batch.
+  BatchAssembler batch_assembler_;
+
+  // The current training batch.
+  ExampleBatch batch_;
 
   // Used to generate additional training examples through synthetic transformations.
   ExampleGenerator* example_generator_;
@@ -49,6 +86,15 @@ private:
 
   // Number of total batches trained on so far.
   int num_batches_;
+
+  // Not owned; may be NULL.
+  TrainingStats* training_stats_;
+
+  // Not owned.
+  std::vector<HardExampleSampler*> hard_example_samplers_;
+
+  // Loss of each example of the last batch.
+  std::vector<float> example_losses_;
 };
 
 #endif // TRACKER_TRAINER_H
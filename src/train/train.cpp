@@ -2,89 +2,92 @@
 
 #include <string>
 #include <iostream>
+#include <thread>
 
 #include <caffe/caffe.hpp>
+#include <gflags/gflags.h>
 
 #include "example_generator.h"
 #include "helper/helper.h"
 #include "loader/loader_imagenet_det.h"
 #include "loader/loader_alov.h"
 #include "network/regressor_train.h"
+#include "network/regressor_train_distill.h"
+#include "network/regressor_train_head.h"
+#include "train/background_validator.h"
+#include "train/example_producer.h"
+#include "train/gradient_averager.h"
+#include "train/hard_example_sampler.h"
+#include "train/target_cache.h"
+#include "train/training_stats.h"
 #include "train/tracker_trainer.h"
+#include "train/train_sampler.h"
 #include "tracker/tracker_manager.h"
 #include "loader/video.h"
 #include "loader/video_loader.h"
 
 using std::string;
-
-// Desired number of training batches.
+namespace bfs = boost::filesystem;
+
+DEFINE_int32(num_replicas, 1,
+             "Number of data-parallel replicas of the network to train on the CPU, "
+             "each on its own set of cores, averaging their gradients at every step.");
+DEFINE_string(teacher_model, "",
+              "If set, train.prototxt is a compact student network (e.g. "
+              "nets/tracker_student.prototxt), which is trained by distillation from this "
+              "trained tracker model.");
+DEFINE_string(teacher_proto, "nets/tracker.prototxt",
+              "Network of the --teacher_model.");
+DEFINE_int32(batch_size, 50,
+             "Number of examples in each forward and backward pass.  With iter_size: N in "
+             "the solver file, the gradients of N such batches are accumulated at each "
+             "solver step (e.g. --batch_size=25 with iter_size: 4 trains on batches of 100 "
+             "examples, with the memory of a batch of 25).");
+DEFINE_bool(hard_example_mining, false,
+            "Sample the training annotations in proportion to the most recent loss of "
+            "their examples, rather than uniformly.  The producers then sample from "
+            "losses that the training threads update concurrently, so runs with the "
+            "same seed are no longer reproducible.");
+DEFINE_bool(cache_target_features, true,
+            "When training only the head, also keep the backbone features of as many "
+            "targets as --target_cache_size, so that cached targets are not passed "
+            "through the backbone again.  If false, only the features of the most "
+            "recent targets are kept.");
+DEFINE_double(uniform_sample_fraction, 0.2,
+              "With --hard_example_mining, the fraction of annotations that are still "
+              "sampled uniformly, so that the loss of every annotation keeps being updated.");
+
+// Desired number of training steps (batches, without gradient accumulation).
 const int kNumBatches = 500000;
 
-namespace {
-
-// Train on a random image.
-void train_image(const LoaderImagenetDet& image_loader,
-           const std::vector<std::vector<Annotation> >& images,
-           TrackerTrainer* tracker_trainer) {
-  // Get a random image.
-  const int image_num = rand() % images.size();
-  const std::vector<Annotation>& annotations = images[image_num];
-
-  // Choose a random annotation.
-  const int annotation_num = rand() % annotations.size();
-
-  // Load the image with its ground-truth bounding box.
-  cv::Mat image;
-  BoundingBox bbox;
-  image_loader.LoadAnnotation(image_num, annotation_num, &image, &bbox);
-
-  // Train on this example
-  tracker_trainer->Train(image, image, bbox, bbox);
-}
-
-// Train on all annotated frames in the set of videos.
-void train_video(const std::vector<Video>& videos, TrackerTrainer* tracker_trainer) {
-  // Get a random video.
-  const int video_num = rand() % videos.size();
-  const Video& video = videos[video_num];
-
-  // Get the video's annotations.
-  const std::vector<Frame>& annotations = video.annotations;
-
-  // We need at least 2 annotations in this video for this to be useful.
-  if (annotations.size() < 2) {
-    printf("Error - video %s has only %zu annotations\n", video.path.c_str(),
-           annotations.size());
-    return;
-  }
-
-  // Choose a random annotation.
-  const int annotation_index = rand() % (annotations.size() - 1);
+// Maximum number of complete batches waiting to be trained on, per producer thread.
+const int kQueuedBatchesPerThread = 2;
 
-  // Load the frame's annotation.
-  int frame_num_prev;
-  cv::Mat image_prev;
-  BoundingBox bbox_prev;
-  video.LoadAnnotation(annotation_index, &frame_num_prev, &image_prev, &bbox_prev);
+// How often to print the training throughput, in batches, if the solver does
+// not set a display interval.
+const int kDefaultStatsInterval = 100;
 
-  // Load the next frame's annotation.
-  int frame_num_curr;
-  cv::Mat image_curr;
-  BoundingBox bbox_curr;
-  video.LoadAnnotation(annotation_index + 1, &frame_num_curr, &image_curr, &bbox_curr);
+// How often to validate the network, in batches.
+const int kValidationInterval = 5000;
 
-  // Train on this example
-  tracker_trainer->Train(image_prev, image_curr, bbox_prev, bbox_curr);
+// Number of validation videos to track at each validation.
+const size_t kNumValidationVideos = 20;
 
-  // Save
-  frame_num_prev = frame_num_curr;
-  image_prev = image_curr;
-  bbox_prev = bbox_curr;
-}
+// Size of the cached target crops (the network input size).
+const int kTargetCropSize = 227;
 
-} // namespace
+// With hard example mining, the loss of annotations that have not been trained
+// on yet: about the loss of an example early in training (the bounding box
+// coordinates are scaled to 10 times the search region), so that they are sampled
+// at least as often as the examples that are still hard.
+const double kInitialExampleLoss = 4.0;
 
 int main (int argc, char *argv[]) {
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = ::google;
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
   if (argc < 14) {
     std::cerr << "Usage: " << argv[0]
               << " videos_folder_imagenet annotations_folder_imagenet"
@@ -92,8 +95,20 @@ int main (int argc, char *argv[]) {
               << " network.caffemodel train.prototxt val.prototxt"
               << " solver_file"
               << " lambda_shift lambda_scale min_scale max_scale"
-              << " gpu_id"
+              << " gpu_id random_seed [num_threads] [backbone.prototxt head.prototxt]"
               << std::endl;
+    std::cerr << "num_threads is the number of threads generating training examples"
+              << " (default: one less than the number of cores);"
+              << " 0 generates them on the training thread." << std::endl;
+    std::cerr << "To read the images from shards packed by pack_shards, pass the shard prefix"
+              << " (e.g. packed/imagenet_det or packed/alov) as the images folder;"
+              << " the annotations folder is then ignored." << std::endl;
+    std::cerr << "If backbone.prototxt and head.prototxt are given, only the fully connected"
+              << " head is trained, on features computed by the frozen backbone." << std::endl;
+    std::cerr << "With --teacher_model=tracker.caffemodel, the compact network in train.prototxt"
+              << " is trained to regress the estimates of that tracker." << std::endl;
+    std::cerr << "With --num_replicas=N, N copies of the network are trained on the CPU in"
+              << " parallel, each on its own batches, averaging their gradients." << std::endl;
     return 1;
   }
 
@@ -115,6 +130,27 @@ int main (int argc, char *argv[]) {
   const double max_scale           = atof(argv[arg_index++]);
   const int gpu_id          = atoi(argv[arg_index++]);
   const int random_seed          = atoi(argv[arg_index++]);
+  const int num_threads = argc > arg_index ? atoi(argv[arg_index++]) :
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  const string backbone_proto = argc > arg_index + 1 ? argv[arg_index++] : "";
+  const string head_proto     = argc > arg_index ? argv[arg_index++] : "";
+
+  if (FLAGS_batch_size < 1) {
+    std::cerr << "The batch size must be positive" << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_num_replicas < 1 || (FLAGS_num_replicas > 1 && !head_proto.empty())) {
+    std::cerr << "Data-parallel replicas are only supported when training the full network"
+              << std::endl;
+    return 1;
+  }
+
+  if (!FLAGS_teacher_model.empty() && (FLAGS_num_replicas > 1 || !head_proto.empty())) {
+    std::cerr << "Distillation is only supported when training the full network, without replicas"
+              << std::endl;
+    return 1;
+  }
 
   caffe::Caffe::set_random_seed(random_seed);
   printf("Using random seed: %d\n", random_seed);
@@ -129,37 +165,288 @@ int main (int argc, char *argv[]) {
 #endif
 
   // Load the image data.
-  LoaderImagenetDet image_loader(videos_folder_imagenet, annotations_folder_imagenet);
-  const std::vector<std::vector<Annotation> >& train_images = image_loader.get_images();
+  boost::shared_ptr<LoaderImagenetDet> image_loader;
+  if (bfs::is_regular_file(ShardIndexFile(videos_folder_imagenet))) {
+    image_loader.reset(new LoaderImagenetDet(videos_folder_imagenet));
+  } else {
+    image_loader.reset(new LoaderImagenetDet(videos_folder_imagenet, annotations_folder_imagenet));
+  }
+  const std::vector<std::vector<Annotation> >& train_images = image_loader->get_images();
   printf("Total training images: %zu\n", train_images.size());
 
   // Load the video data.
-  LoaderAlov alov_video_loader(alov_videos_folder, alov_annotations_folder);
+  boost::shared_ptr<LoaderAlov> alov_video_loader;
+  if (bfs::is_regular_file(ShardIndexFile(alov_videos_folder))) {
+    alov_video_loader.reset(new LoaderAlov(alov_videos_folder));
+  } else {
+    alov_video_loader.reset(new LoaderAlov(alov_videos_folder, alov_annotations_folder));
+  }
   const bool get_train = true;
   std::vector<Video> train_videos;
-  alov_video_loader.get_videos(get_train, &train_videos);
+  alov_video_loader->get_videos(get_train, &train_videos);
   printf("Total training videos: %zu\n", train_videos.size());
 
+  // Validate on a fixed subset of the validation videos, spread over the categories.
+  std::vector<Video> all_val_videos;
+  alov_video_loader->get_videos(!get_train, &all_val_videos);
+  std::vector<Video> val_videos;
+  const size_t val_stride = std::max<size_t>(1, all_val_videos.size() / kNumValidationVideos);
+  for (size_t i = 0; i < all_val_videos.size() && val_videos.size() < kNumValidationVideos;
+       i += val_stride) {
+    val_videos.push_back(all_val_videos[i]);
+  }
+  printf("Validating on %zu of %zu validation videos\n", val_videos.size(),
+         all_val_videos.size());
+
+  // Sample the hard examples more often, if requested.
+  boost::shared_ptr<HardExampleSampler> image_sampler;
+  boost::shared_ptr<HardExampleSampler> video_sampler;
+  std::vector<HardExampleSampler*> samplers;
+  if (FLAGS_hard_example_mining) {
+    std::vector<int> num_annotations;
+    for (size_t i = 0; i < train_images.size(); ++i) {
+      num_annotations.push_back(train_images[i].size());
+    }
+    image_sampler.reset(new HardExampleSampler(kImageDataset, num_annotations,
+                                               FLAGS_uniform_sample_fraction,
+                                               kInitialExampleLoss));
+
+    // Videos are sampled by pairs of consecutive annotations.
+    num_annotations.clear();
+    for (size_t i = 0; i < train_videos.size(); ++i) {
+      num_annotations.push_back(std::max<int>(0, train_videos[i].annotations.size() - 1));
+    }
+    video_sampler.reset(new HardExampleSampler(kVideoDataset, num_annotations,
+                                               FLAGS_uniform_sample_fraction,
+                                               kInitialExampleLoss));
+
+    samplers.push_back(image_sampler.get());
+    samplers.push_back(video_sampler.get());
+    printf("Sampling hard examples, with %.0lf%% of the annotations sampled uniformly\n",
+           FLAGS_uniform_sample_fraction * 100);
+  }
+
   // Create an ExampleGenerator to generate training examples.
   ExampleGenerator example_generator(lambda_shift, lambda_scale,
                                      min_scale, max_scale);
 
   // Set up network.
-  RegressorTrain regressor_train(train_proto, caffe_model,
-                                 gpu_id, solver_file);
+  boost::shared_ptr<RegressorTrainBase> regressor_train;
+  if (!head_proto.empty()) {
+    printf("Training only the head (%s) on features from %s\n", head_proto.c_str(),
+           backbone_proto.c_str());
+    RegressorTrainHead* regressor_train_head =
+        new RegressorTrainHead(backbone_proto, head_proto, caffe_model, gpu_id, solver_file);
+    // Also keep the features of the cached targets, if requested.
+    if (FLAGS_cache_target_features && FLAGS_target_cache_size > 0) {
+      regressor_train_head->set_max_cached_targets(FLAGS_target_cache_size);
+    }
+    regressor_train.reset(regressor_train_head);
+  } else if (!FLAGS_teacher_model.empty()) {
+    regressor_train.reset(new RegressorTrainDistill(train_proto, caffe_model,
+                                                    FLAGS_teacher_proto, FLAGS_teacher_model,
+                                                    gpu_id, solver_file));
+  } else {
+    regressor_train.reset(new RegressorTrain(train_proto, caffe_model,
+                                             gpu_id, solver_file));
+  }
+
+  // Report the throughput and the time spent in each stage of training every
+  // display iterations of the solver, also saving the reports next to the snapshots.
+  const caffe::SolverParameter& solver_param = regressor_train->get_solver_param();
+  const int display_interval = solver_param.display() > 0 ? solver_param.display() :
+                                                            kDefaultStatsInterval;
+
+  // With gradient accumulation, each solver step trains on iter_size batches,
+  // which are what the training loops count.
+  const int iter_size = regressor_train->get_batches_per_step();
+  const int num_batches_to_train = kNumBatches * iter_size;
+  const int stats_interval = display_interval * iter_size;
+  const int validation_interval = kValidationInterval * iter_size;
+  printf("Training on batches of %d examples", FLAGS_batch_size);
+  if (iter_size > 1) {
+    printf(", accumulating the gradients of %d batches at each step", iter_size);
+  }
+  printf("\n");
+
+  TrainingStats training_stats;
+  training_stats.OpenCsv(solver_param.snapshot_prefix() + "_stats.csv");
 
-  // Set up trainer.
-  TrackerTrainer tracker_trainer(&example_generator, &regressor_train);
+  // Track the validation videos in the background while training.
+  boost::shared_ptr<BackgroundValidator> validator;
+  if (!val_videos.empty()) {
+    validator.reset(new BackgroundValidator(val_videos, train_proto, caffe_model, gpu_id));
+  }
+
+  // Targets of annotations that have already been sampled.
+  TargetCache target_cache(FLAGS_target_cache_size, cv::Size(kTargetCropSize, kTargetCropSize));
+
+  // The random scale changes shrink the crops by at most a factor of (1 + min_scale),
+  // so decoding the images at the lowest resolution at which the unshifted crops
+  // are at least this large keeps every crop at network resolution.
+  const double min_crop_size = kTargetCropSize / std::max(1 + min_scale, 0.1);
+  printf("Decoding images at reduced resolution for crops of at least %.0lf pixels\n",
+         min_crop_size);
 
-  // Train tracker.
-  while (tracker_trainer.get_num_batches() < kNumBatches) {
+  // Each training step uses one image example and one video example.
+  ExampleProducer::SampleFunction sample = [&](Rng* rng, TrackerTrainer* tracker_trainer) {
     // Train on an image example.
-    train_image(image_loader, train_images, &tracker_trainer);
+    train_image(*image_loader, train_images, min_crop_size, &target_cache,
+                image_sampler.get(), rng, tracker_trainer);
 
     // Train on a video example.
-    train_video(train_videos, &tracker_trainer);
+    train_video(train_videos, min_crop_size, &target_cache, video_sampler.get(), rng,
+                tracker_trainer);
+  };
+
+  if (num_threads == 0 && FLAGS_num_replicas == 1) {
+    // Set up trainer, with the same random streams as the first producer thread.
+    Rng rng(random_seed, 0);
+    example_generator.set_random_seed(random_seed, 1);
+    TrackerTrainer tracker_trainer(&example_generator, regressor_train.get());
+    tracker_trainer.set_batch_size(FLAGS_batch_size);
+    tracker_trainer.set_training_stats(&training_stats);
+    tracker_trainer.set_hard_example_samplers(samplers);
+
+    // Train tracker.
+    int next_report = stats_interval;
+    int next_validation = validation_interval;
+    while (tracker_trainer.get_num_batches() < num_batches_to_train) {
+      sample(&rng, &tracker_trainer);
+
+      if (tracker_trainer.get_num_batches() >= next_report) {
+        training_stats.Report(tracker_trainer.get_num_batches());
+        target_cache.PrintStats();
+        for (size_t i = 0; i < samplers.size(); ++i) {
+          samplers[i]->PrintStats();
+        }
+        next_report += stats_interval;
+      }
+
+      if (validator && tracker_trainer.get_num_batches() >= next_validation) {
+        validator->Validate(tracker_trainer.get_num_batches() / iter_size,
+                            regressor_train.get());
+        next_validation += validation_interval;
+      }
+    }
+    return 0;
+  }
+
+  // Set up the data-parallel replicas of the network, if any.  All replicas
+  // have the same weights, so only the first one logs and saves snapshots.
+  std::vector<RegressorTrainBase*> replicas(1, regressor_train.get());
+  std::vector<boost::shared_ptr<RegressorTrainBase> > extra_replicas;
+  for (int i = 1; i < FLAGS_num_replicas; ++i) {
+    caffe::SolverParameter replica_solver_param;
+    caffe::ReadSolverParamsFromTextFileOrDie(solver_file, &replica_solver_param);
+    replica_solver_param.set_display(0);
+    replica_solver_param.set_snapshot(0);
+    replica_solver_param.set_snapshot_after_train(false);
+    extra_replicas.push_back(boost::shared_ptr<RegressorTrainBase>(
+        new RegressorTrain(train_proto, caffe_model, gpu_id, replica_solver_param)));
+    replicas.push_back(extra_replicas.back().get());
+  }
+  boost::shared_ptr<GradientAverager> gradient_averager;
+  if (replicas.size() > 1) {
+    gradient_averager.reset(new GradientAverager(replicas));
   }
 
+  // Each replica, with its producer threads, runs on its own set of cores.
+  const int num_replicas = replicas.size();
+  const int threads_per_replica = std::max(1, num_threads / num_replicas);
+  const int cores_per_replica = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) /
+                                            num_replicas);
+
+  // Generate complete batches on num_threads producer threads, while the
+  // training threads only run the solver.  Each producer has its own random
+  // streams, and each replica takes the batches from its producers in turn, so
+  // the same seed and number of threads always give the same sequence of batches.
+  // The exception is hard example mining: all producers sample from the same
+  // losses, which the training threads update as they go, so which losses a
+  // producer sees depends on how far ahead of training it is running.
+  printf("Generating training examples on %d threads for %d replicas\n",
+         threads_per_replica * num_replicas, num_replicas);
+  std::vector<boost::shared_ptr<ExampleProducer> > producers;
+  for (int i = 0; i < threads_per_replica * num_replicas; ++i) {
+    producers.push_back(boost::shared_ptr<ExampleProducer>(
+        new ExampleProducer(example_generator, sample, random_seed, i,
+                            kQueuedBatchesPerThread)));
+    producers.back()->set_batch_size(FLAGS_batch_size);
+    producers.back()->set_training_stats(&training_stats);
+    if (num_replicas > 1) {
+      producers.back()->set_cores((i / threads_per_replica) * cores_per_replica,
+                                  cores_per_replica);
+    }
+    producers.back()->Start();
+  }
+
+  // Train each replica for kNumBatches steps; with several replicas, each step
+  // trains on one batch (or iter_size batches) from every replica.
+  auto train_replica = [&](const int replica) {
+    if (num_replicas > 1) {
+      // Data-parallel training runs on the CPU.
+      set_thread_affinity(replica * cores_per_replica, cores_per_replica);
+      caffe::Caffe::set_mode(caffe::Caffe::CPU);
+      caffe::Caffe::set_random_seed(random_seed + replica);
+    }
+
+    ExampleBatch batch;
+    std::vector<float> example_losses;
+    for (int num_batches = 1; num_batches <= num_batches_to_train; ++num_batches) {
+      {
+        StageTimer timer(&training_stats, TrainingStats::kStageWait);
+        const int producer = replica * threads_per_replica +
+                             (num_batches - 1) % threads_per_replica;
+        producers[producer]->Pop(&batch);
+      }
+      {
+        StageTimer timer(&training_stats, TrainingStats::kStageSolver);
+        replicas[replica]->Train(batch);
+      }
+      training_stats.AddBatches(1);
+
+      // Sample the examples that the network gets most wrong more often.
+      if (!samplers.empty()) {
+        replicas[replica]->GetExampleLosses(&example_losses);
+        for (size_t i = 0; i < samplers.size(); ++i) {
+          samplers[i]->Update(batch.target_ids, example_losses, batch.num);
+        }
+      }
+
+      if (replica != 0) {
+        continue;
+      }
+
+      if (num_batches % stats_interval == 0) {
+        training_stats.Report(num_batches);
+        target_cache.PrintStats();
+        for (size_t i = 0; i < samplers.size(); ++i) {
+          samplers[i]->PrintStats();
+        }
+      }
+
+      // If the previous validation is still running, this one is skipped.
+      if (validator && num_batches % validation_interval == 0) {
+        validator->Validate(num_batches / iter_size, replicas[replica]);
+      }
+    }
+  };
+
+  if (num_replicas == 1) {
+    train_replica(0);
+  } else {
+    std::vector<std::thread> replica_threads;
+    for (int i = 0; i < num_replicas; ++i) {
+      replica_threads.push_back(std::thread(train_replica, i));
+    }
+    for (int i = 0; i < num_replicas; ++i) {
+      replica_threads[i].join();
+    }
+  }
+
+  // Stop the producers (their destructors wait for them to finish).
+  producers.clear();
+
   return 0;
 }
 
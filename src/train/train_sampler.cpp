@@ -0,0 +1,132 @@
+#include "train_sampler.h"
+
+#include <algorithm>
+
+#include "helper/image_decode.h"
+
+void train_image(const LoaderImagenetDet& image_loader,
+                 const std::vector<std::vector<Annotation> >& images,
+                 const double min_crop_size,
+                 TargetCache* target_cache,
+                 HardExampleSampler* sampler,
+                 Rng* rng,
+                 TrackerTrainer* tracker_trainer) {
+  // Choose a random annotation of a random image.
+  int image_num;
+  int annotation_num;
+  if (sampler) {
+    sampler->Sample(rng, &image_num, &annotation_num);
+  } else {
+    image_num = rng->UniformInt(images.size());
+    annotation_num = rng->UniformInt(images[image_num].size());
+  }
+  const std::vector<Annotation>& annotations = images[image_num];
+
+  // Load the image with its ground-truth bounding box, decoding it at the
+  // lowest resolution that keeps the crops at least at network resolution.
+  const int reduction = ComputeDecodeReduction(annotations[annotation_num].bbox, min_crop_size);
+  cv::Mat image;
+  BoundingBox bbox;
+  TrainingStats* training_stats = tracker_trainer->get_training_stats();
+  {
+    StageTimer timer(training_stats, TrainingStats::kStageDecode);
+    image_loader.LoadAnnotation(image_num, annotation_num, reduction, &image, &bbox);
+  }
+  if (training_stats) {
+    training_stats->AddImages(1);
+  }
+
+  // Train on this example, reusing the target if it has been cropped before.
+  const uint64_t key = TargetCache::MakeKey(kImageDataset, image_num, annotation_num);
+  cv::Mat target;
+  if (target_cache && target_cache->Find(key, &target)) {
+    tracker_trainer->TrainWithTarget(target, image, bbox, bbox, key);
+  } else {
+    tracker_trainer->Train(image, image, bbox, bbox, key);
+    if (target_cache) {
+      target_cache->Insert(key, tracker_trainer->get_target());
+    }
+  }
+}
+
+void train_video(const std::vector<Video>& videos, const double min_crop_size,
+                 TargetCache* target_cache, HardExampleSampler* sampler, Rng* rng,
+                 TrackerTrainer* tracker_trainer) {
+  // Get a random video (and, with a sampler, its annotation).
+  int video_num;
+  int sampled_annotation_index = 0;
+  if (sampler) {
+    sampler->Sample(rng, &video_num, &sampled_annotation_index);
+  } else {
+    video_num = rng->UniformInt(videos.size());
+  }
+  const Video& video = videos[video_num];
+
+  // Get the video's annotations.
+  const std::vector<Frame>& annotations = video.annotations;
+
+  // We need at least 2 annotations in this video for this to be useful.
+  if (annotations.size() < 2) {
+    printf("Error - video %s has only %zu annotations\n", video.path.c_str(),
+           annotations.size());
+    return;
+  }
+
+  // Choose a random annotation.
+  const int annotation_index = sampler ? sampled_annotation_index :
+                                         rng->UniformInt(annotations.size() - 1);
+
+  // Both frames are decoded at the same resolution, the lowest that keeps the
+  // crops around both annotations at least at network resolution.
+  const int reduction =
+      std::min(ComputeDecodeReduction(annotations[annotation_index].bbox, min_crop_size),
+               ComputeDecodeReduction(annotations[annotation_index + 1].bbox, min_crop_size));
+
+  // Load the next frame's annotation.
+  int frame_num_curr;
+  cv::Mat image_curr;
+  BoundingBox bbox_curr;
+  TrainingStats* training_stats = tracker_trainer->get_training_stats();
+  int actual_reduction;
+  {
+    StageTimer timer(training_stats, TrainingStats::kStageDecode);
+    actual_reduction = video.LoadAnnotation(annotation_index + 1, reduction,
+                                            &frame_num_curr, &image_curr, &bbox_curr);
+  }
+  if (training_stats) {
+    training_stats->AddImages(1);
+  }
+
+  // If the target has been cropped before, the previous frame does not need to be loaded.
+  const uint64_t key = TargetCache::MakeKey(kVideoDataset, video_num, annotation_index);
+  cv::Mat target;
+  if (target_cache && target_cache->Find(key, &target)) {
+    // Scale the previous bounding box to the decoded image.
+    BoundingBox bbox_prev = annotations[annotation_index].bbox;
+    bbox_prev.x1_ /= actual_reduction;
+    bbox_prev.x2_ /= actual_reduction;
+    bbox_prev.y1_ /= actual_reduction;
+    bbox_prev.y2_ /= actual_reduction;
+    tracker_trainer->TrainWithTarget(target, image_curr, bbox_prev, bbox_curr, key);
+    return;
+  }
+
+  // Load the frame's annotation.
+  int frame_num_prev;
+  cv::Mat image_prev;
+  BoundingBox bbox_prev_loaded;
+  {
+    StageTimer timer(training_stats, TrainingStats::kStageDecode);
+    video.LoadAnnotation(annotation_index, actual_reduction, &frame_num_prev, &image_prev,
+                         &bbox_prev_loaded);
+  }
+  if (training_stats) {
+    training_stats->AddImages(1);
+  }
+
+  // Train on this example
+  tracker_trainer->Train(image_prev, image_curr, bbox_prev_loaded, bbox_curr, key);
+  if (target_cache) {
+    target_cache->Insert(key, tracker_trainer->get_target());
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef TRAIN_SAMPLER_H
+#define TRAIN_SAMPLER_H
+
+#include <vector>
+
+#include "helper/rng.h"
+#include "loader/loader_imagenet_det.h"
+#include "loader/video.h"
+#include "train/hard_example_sampler.h"
+#include "train/target_cache.h"
+#include "train/tracker_trainer.h"
+
+// If target_cache is not NULL, targets are looked up in (and added to) the cache,
+// so that a target is only cropped (and, for videos, its frame is only decoded)
+// the first time that its annotation is sampled.
+//
+// Images are decoded at reduced resolution (see ComputeDecodeReduction) when
+// the padded crops around the sampled objects would still be at least
+// min_crop_size pixels wide and high; pass a very large min_crop_size to always
+// decode images at full resolution.
+
+// The examples are chosen with rng, so a given sequence of random numbers
+// always gives the same examples.  If sampler is not NULL, the annotations are
+// chosen with it (in proportion to their loss) rather than uniformly.
+
+// Datasets, to distinguish their annotations in the target cache and the samplers.
+const int kImageDataset = 0;
+const int kVideoDataset = 1;
+
+// Train on a random annotated object from a random image.
+void train_image(const LoaderImagenetDet& image_loader,
+                 const std::vector<std::vector<Annotation> >& images,
+                 const double min_crop_size,
+                 TargetCache* target_cache,
+                 HardExampleSampler* sampler,
+                 Rng* rng,
+                 TrackerTrainer* tracker_trainer);
+
+// Train on a random pair of consecutive annotated frames from a random video.
+void train_video(const std::vector<Video>& videos, const double min_crop_size,
+                 TargetCache* target_cache, HardExampleSampler* sampler, Rng* rng,
+                 TrackerTrainer* tracker_trainer);
+
+#endif // TRAIN_SAMPLER_H
@@ -0,0 +1,275 @@
+// Train several configurations of the tracker (e.g. a hyperparameter sweep)
+// in one process, from the same stream of decoded images: each configuration
+// has its own example generator parameters, learning rate, network, snapshots
+// and log, but the images are only decoded (and the targets only cropped) once.
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <caffe/caffe.hpp>
+#include <gflags/gflags.h>
+
+#include "example_generator.h"
+#include "helper/helper.h"
+#include "loader/loader_imagenet_det.h"
+#include "loader/loader_alov.h"
+#include "network/regressor_train.h"
+#include "train/example_producer.h"
+#include "train/target_cache.h"
+#include "train/training_stats.h"
+#include "train/train_sampler.h"
+
+using std::string;
+namespace bfs = boost::filesystem;
+
+namespace {
+
+// Desired number of training steps (batches, without gradient accumulation),
+// for each configuration.
+const int kNumBatches = 500000;
+
+// Maximum number of complete batches waiting to be trained on, per producer
+// thread and configuration.
+const int kQueuedBatchesPerThread = 2;
+
+// How often to log the loss of each configuration and print the throughput,
+// in batches, if the solver does not set a display interval.
+const int kDefaultLogInterval = 100;
+
+// Size of the cached target crops (the network input size).
+const int kTargetCropSize = 227;
+
+// A configuration of the sweep.
+struct SweepConfig {
+  string name;
+  double lambda_shift;
+  double lambda_scale;
+  double min_scale;
+  double max_scale;
+  double base_lr;
+};
+
+// Read the configurations, one per line:
+//   name lambda_shift lambda_scale min_scale max_scale base_lr
+// Empty lines and lines starting with # are ignored.
+bool ReadSweepConfigs(const string& sweep_file, std::vector<SweepConfig>* configs) {
+  std::ifstream input(sweep_file.c_str());
+  if (!input) {
+    printf("Error - could not open %s\n", sweep_file.c_str());
+    return false;
+  }
+
+  string line;
+  while (std::getline(input, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream line_stream(line);
+    SweepConfig config;
+    if (!(line_stream >> config.name >> config.lambda_shift >> config.lambda_scale
+                      >> config.min_scale >> config.max_scale >> config.base_lr)) {
+      printf("Error - could not parse line of %s: %s\n", sweep_file.c_str(), line.c_str());
+      return false;
+    }
+    configs->push_back(config);
+  }
+  return !configs->empty();
+}
+
+} // namespace
+
+int main (int argc, char *argv[]) {
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = ::google;
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc < 11) {
+    std::cerr << "Usage: " << argv[0]
+              << " videos_folder_imagenet annotations_folder_imagenet"
+              << " alov_videos_folder alov_annotations_folder"
+              << " network.caffemodel train.prototxt solver_file sweep_file"
+              << " gpu_id random_seed [num_threads]"
+              << std::endl;
+    std::cerr << "Each line of sweep_file is a configuration:"
+              << " name lambda_shift lambda_scale min_scale max_scale base_lr" << std::endl;
+    std::cerr << "The snapshots and the loss log of each configuration are saved with the"
+              << " snapshot prefix of solver_file, followed by _name." << std::endl;
+    return 1;
+  }
+
+  FLAGS_alsologtostderr = 1;
+
+  ::google::InitGoogleLogging(argv[0]);
+
+  int arg_index = 1;
+  const string& videos_folder_imagenet      = argv[arg_index++];
+  const string& annotations_folder_imagenet = argv[arg_index++];
+  const string& alov_videos_folder      = argv[arg_index++];
+  const string& alov_annotations_folder = argv[arg_index++];
+  const string& caffe_model   = argv[arg_index++];
+  const string& train_proto   = argv[arg_index++];
+  const string& solver_file  = argv[arg_index++];
+  const string& sweep_file  = argv[arg_index++];
+  const int gpu_id          = atoi(argv[arg_index++]);
+  const int random_seed          = atoi(argv[arg_index++]);
+  const int num_threads = std::max(1, argc > arg_index ? atoi(argv[arg_index++]) :
+      static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
+  std::vector<SweepConfig> configs;
+  if (!ReadSweepConfigs(sweep_file, &configs)) {
+    std::cerr << "No configurations in " << sweep_file << std::endl;
+    return 1;
+  }
+  const int num_configs = configs.size();
+
+  caffe::Caffe::set_random_seed(random_seed);
+  printf("Using random seed: %d\n", random_seed);
+
+  // Load the image data.
+  boost::shared_ptr<LoaderImagenetDet> image_loader;
+  if (bfs::is_regular_file(ShardIndexFile(videos_folder_imagenet))) {
+    image_loader.reset(new LoaderImagenetDet(videos_folder_imagenet));
+  } else {
+    image_loader.reset(new LoaderImagenetDet(videos_folder_imagenet, annotations_folder_imagenet));
+  }
+  const std::vector<std::vector<Annotation> >& train_images = image_loader->get_images();
+  printf("Total training images: %zu\n", train_images.size());
+
+  // Load the video data.
+  boost::shared_ptr<LoaderAlov> alov_video_loader;
+  if (bfs::is_regular_file(ShardIndexFile(alov_videos_folder))) {
+    alov_video_loader.reset(new LoaderAlov(alov_videos_folder));
+  } else {
+    alov_video_loader.reset(new LoaderAlov(alov_videos_folder, alov_annotations_folder));
+  }
+  const bool get_train = true;
+  std::vector<Video> train_videos;
+  alov_video_loader->get_videos(get_train, &train_videos);
+  printf("Total training videos: %zu\n", train_videos.size());
+
+  // Set up the example generator, network and log of each configuration.  The
+  // solvers do not display the loss themselves, since their output would be
+  // interleaved; instead, each configuration logs its loss to its own file.
+  caffe::SolverParameter solver_param;
+  caffe::ReadSolverParamsFromTextFileOrDie(solver_file, &solver_param);
+  const int display_interval = solver_param.display() > 0 ? solver_param.display() :
+                                                            kDefaultLogInterval;
+  std::vector<ExampleGenerator> example_generators;
+  std::vector<boost::shared_ptr<RegressorTrain> > regressors;
+  std::vector<FILE*> logs;
+  double lowest_min_scale = 0;
+  for (int i = 0; i < num_configs; ++i) {
+    const SweepConfig& config = configs[i];
+    printf("Configuration %s: lambda_shift %lf, lambda_scale %lf, min_scale %lf,"
+           " max_scale %lf, base_lr %g\n", config.name.c_str(), config.lambda_shift,
+           config.lambda_scale, config.min_scale, config.max_scale, config.base_lr);
+    example_generators.push_back(ExampleGenerator(config.lambda_shift, config.lambda_scale,
+                                                  config.min_scale, config.max_scale));
+    lowest_min_scale = std::min(lowest_min_scale, config.min_scale);
+
+    caffe::SolverParameter config_solver_param = solver_param;
+    config_solver_param.set_base_lr(config.base_lr);
+    config_solver_param.set_display(0);
+    config_solver_param.set_snapshot_prefix(solver_param.snapshot_prefix() + "_" + config.name);
+    regressors.push_back(boost::shared_ptr<RegressorTrain>(
+        new RegressorTrain(train_proto, caffe_model, gpu_id, config_solver_param)));
+
+    const string log_file = config_solver_param.snapshot_prefix() + "_loss.csv";
+    logs.push_back(fopen(log_file.c_str(), "w"));
+    if (!logs.back()) {
+      std::cerr << "Could not open " << log_file << std::endl;
+      return 1;
+    }
+    fprintf(logs.back(), "iteration,mean_loss\n");
+  }
+
+  // With gradient accumulation, each solver step trains on iter_size batches,
+  // which are what the training loop counts (all configurations share the
+  // solver's iter_size).
+  const int iter_size = regressors[0]->get_batches_per_step();
+  const int num_batches_to_train = kNumBatches * iter_size;
+  const int log_interval = display_interval * iter_size;
+
+  // Report the throughput of the shared pipeline.
+  TrainingStats training_stats;
+  training_stats.OpenCsv(solver_param.snapshot_prefix() + "_sweep_stats.csv");
+
+  // Targets of annotations that have already been sampled (the same for all configurations).
+  TargetCache target_cache(FLAGS_target_cache_size, cv::Size(kTargetCropSize, kTargetCropSize));
+
+  // Decode the images at a resolution that keeps the crops of every
+  // configuration at network resolution (see train).
+  const double min_crop_size = kTargetCropSize / std::max(1 + lowest_min_scale, 0.1);
+
+  // Each step uses one image example and one video example, which are passed
+  // on to all configurations.
+  ExampleProducer::SampleFunction sample = [&](Rng* rng, TrackerTrainer* tracker_trainer) {
+    train_image(*image_loader, train_images, min_crop_size, &target_cache, NULL, rng,
+                tracker_trainer);
+    train_video(train_videos, min_crop_size, &target_cache, NULL, rng, tracker_trainer);
+  };
+
+  printf("Generating training examples for %d configurations on %d threads\n", num_configs,
+         num_threads);
+  std::vector<boost::shared_ptr<ExampleProducer> > producers;
+  for (int i = 0; i < num_threads; ++i) {
+    producers.push_back(boost::shared_ptr<ExampleProducer>(
+        new ExampleProducer(example_generators, sample, random_seed, i,
+                            kQueuedBatchesPerThread)));
+    producers.back()->set_training_stats(&training_stats);
+    producers.back()->Start();
+  }
+
+  // Train the configurations in turn, one batch each.
+  ExampleBatch batch;
+  std::vector<float> example_losses;
+  std::vector<double> interval_losses(num_configs, 0);
+  for (int num_batches = 1; num_batches <= num_batches_to_train; ++num_batches) {
+    const int producer = (num_batches - 1) % num_threads;
+    for (int i = 0; i < num_configs; ++i) {
+      {
+        StageTimer timer(&training_stats, TrainingStats::kStageWait);
+        producers[producer]->Pop(i, &batch);
+      }
+      {
+        StageTimer timer(&training_stats, TrainingStats::kStageSolver);
+        regressors[i]->Train(batch);
+      }
+      training_stats.AddBatches(1);
+
+      // The loss of the batch is the sum of the losses of its examples.
+      regressors[i]->GetExampleLosses(&example_losses);
+      for (size_t j = 0; j < example_losses.size(); ++j) {
+        interval_losses[i] += example_losses[j];
+      }
+    }
+
+    if (num_batches % log_interval == 0) {
+      for (int i = 0; i < num_configs; ++i) {
+        const double mean_loss = interval_losses[i] / log_interval;
+        printf("[SWEEP] Iteration %d, %s: mean loss %lf\n", num_batches / iter_size,
+               configs[i].name.c_str(), mean_loss);
+        fprintf(logs[i], "%d,%lf\n", num_batches / iter_size, mean_loss);
+        fflush(logs[i]);
+        interval_losses[i] = 0;
+      }
+      training_stats.Report(num_batches);
+      target_cache.PrintStats();
+    }
+  }
+
+  // Stop the producers (their destructors wait for them to finish).
+  producers.clear();
+
+  for (int i = 0; i < num_configs; ++i) {
+    fclose(logs[i]);
+  }
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include "training_stats.h"
+
+TrainingStats::TrainingStats()
+  : num_images_(0),
+    num_examples_(0),
+    num_batches_(0),
+    prev_num_images_(0),
+    prev_num_examples_(0),
+    prev_num_batches_(0),
+    interval_timer_("Training stats", CLOCK_MONOTONIC),
+    csv_(NULL)
+{
+  for (int i = 0; i < kNumStages; ++i) {
+    stage_nanoseconds_[i] = 0;
+    prev_stage_nanoseconds_[i] = 0;
+  }
+  interval_timer_.start();
+}
+
+TrainingStats::~TrainingStats() {
+  if (csv_) {
+    fclose(csv_);
+  }
+}
+
+bool TrainingStats::OpenCsv(const std::string& csv_file) {
+  csv_ = fopen(csv_file.c_str(), "w");
+  if (!csv_) {
+    printf("Could not open training stats file: %s\n", csv_file.c_str());
+    return false;
+  }
+
+  fprintf(csv_, "iteration,seconds,images_per_second,examples_per_second,batches_per_second");
+  for (int i = 0; i < kNumStages; ++i) {
+    fprintf(csv_, ",%s_seconds", get_stage_name(static_cast<Stage>(i)));
+  }
+  fprintf(csv_, "\n");
+  fflush(csv_);
+  return true;
+}
+
+void TrainingStats::AddTime(const Stage stage, const double seconds) {
+  stage_nanoseconds_[stage] += static_cast<uint64_t>(seconds * 1e9);
+}
+
+void TrainingStats::Report(const int iteration) {
+  interval_timer_.stop();
+  const double seconds = interval_timer_.getSeconds();
+  interval_timer_.reset();
+  interval_timer_.start();
+
+  // Compute the rates since the previous report.
+  const uint64_t num_images = num_images_;
+  const uint64_t num_examples = num_examples_;
+  const uint64_t num_batches = num_batches_;
+  const double images_per_second = (num_images - prev_num_images_) / seconds;
+  const double examples_per_second = (num_examples - prev_num_examples_) / seconds;
+  const double batches_per_second = (num_batches - prev_num_batches_) / seconds;
+  prev_num_images_ = num_images;
+  prev_num_examples_ = num_examples;
+  prev_num_batches_ = num_batches;
+
+  printf("[STATS] Iteration %d: %.1lf images/s, %.1lf examples/s, %.2lf batches/s\n",
+         iteration, images_per_second, examples_per_second, batches_per_second);
+
+  // Stages run concurrently on several threads, so their times are summed over
+  // the threads, and shown as a percentage of the wall-clock time.
+  printf("[STATS] Stage time over %.1lf s (summed over threads):", seconds);
+  double stage_seconds[kNumStages];
+  for (int i = 0; i < kNumStages; ++i) {
+    const uint64_t nanoseconds = stage_nanoseconds_[i];
+    stage_seconds[i] = (nanoseconds - prev_stage_nanoseconds_[i]) * 1e-9;
+    prev_stage_nanoseconds_[i] = nanoseconds;
+    printf(" %s %.2lf s (%.0lf%%)", get_stage_name(static_cast<Stage>(i)),
+           stage_seconds[i], 100 * stage_seconds[i] / seconds);
+  }
+  printf("\n");
+
+  if (csv_) {
+    fprintf(csv_, "%d,%lf,%lf,%lf,%lf", iteration, seconds, images_per_second,
+            examples_per_second, batches_per_second);
+    for (int i = 0; i < kNumStages; ++i) {
+      fprintf(csv_, ",%lf", stage_seconds[i]);
+    }
+    fprintf(csv_, "\n");
+    fflush(csv_);
+  }
+}
+
+const char* TrainingStats::get_stage_name(const Stage stage) {
+  switch (stage) {
+    case kStageDecode:
+      return "decode";
+    case kStageCrop:
+      return "crop";
+    case kStagePreprocess:
+      return "preprocess";
+    case kStageWait:
+      return "wait";
+    case kStageSolver:
+      return "solver";
+    default:
+      return "unknown";
+  }
+}
+
+StageTimer::StageTimer(TrainingStats* stats, const TrainingStats::Stage stage)
+  : stats_(stats),
+    stage_(stage),
+    hrt_("Stage", CLOCK_MONOTONIC)
+{
+  if (stats_) {
+    hrt_.start();
+  }
+}
+
+StageTimer::~StageTimer() {
+  if (stats_) {
+    hrt_.stop();
+    stats_->AddTime(stage_, hrt_.getSeconds());
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef TRAINING_STATS_H
+#define TRAINING_STATS_H
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+#include <stdint.h>
+
+#include "helper/high_res_timer.h"
+
+// Wall-clock time spent in each stage of training, and the number of images,
+// examples, and batches processed.  The counters may be updated from any
+// thread (e.g. by every example producer), while Report is called from the
+// training thread.
+class TrainingStats
+{
+public:
+  enum Stage {
+    // Loading and decoding images.
+    kStageDecode,
+    // Cropping the targets and search regions.
+    kStageCrop,
+    // Converting the examples into the batch.
+    kStagePreprocess,
+    // Waiting for a batch from the example producers.
+    kStageWait,
+    // Running the solver.
+    kStageSolver,
+    kNumStages
+  };
+
+  TrainingStats();
+  ~TrainingStats();
+
+  // Also append each report to the given CSV file.  Returns false if the file
+  // cannot be opened.
+  bool OpenCsv(const std::string& csv_file);
+
+  void AddTime(const Stage stage, const double seconds);
+  void AddImages(const int num_images) { num_images_ += num_images; }
+  void AddExamples(const int num_examples) { num_examples_ += num_examples; }
+  void AddBatches(const int num_batches) { num_batches_ += num_batches; }
+
+  // Print the throughput and the time spent in each stage since the previous
+  // report (or since construction), and append them to the CSV file.
+  void Report(const int iteration);
+
+  static const char* get_stage_name(const Stage stage);
+
+private:
+  std::atomic<uint64_t> stage_nanoseconds_[kNumStages];
+  std::atomic<uint64_t> num_images_;
+  std::atomic<uint64_t> num_examples_;
+  std::atomic<uint64_t> num_batches_;
+
+  // Values at the previous report.
+  uint64_t prev_stage_nanoseconds_[kNumStages];
+  uint64_t prev_num_images_;
+  uint64_t prev_num_examples_;
+  uint64_t prev_num_batches_;
+
+  // Time since the previous report.
+  HighResTimer interval_timer_;
+
+  FILE* csv_;
+};
+
+// Adds the wall-clock time of its scope to a stage of the given stats
+// (if stats is not NULL).
+class StageTimer
+{
+public:
+  StageTimer(TrainingStats* stats, const TrainingStats::Stage stage);
+  ~StageTimer();
+
+private:
+  TrainingStats* stats_;
+  TrainingStats::Stage stage_;
+  HighResTimer hrt_;
+};
+
+#endif // TRAINING_STATS_H